@@ -0,0 +1,269 @@
+/***** append.c ***********************************
+ * Description: Append a database created with 
+ *   formatPro to an existing one. Either the new
+ *   database holds further contigs, which are added
+ *   after the existing ones, or it holds further
+ *   reads for the existing contigs, whose counts are 
+ *   added site by site. Profile indexes already in
+ *   use are kept.
+ * License: GNU General Public
+ **************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <assert.h>
+#include "eprintf.h"
+#include "interface.h"
+#include "profile.h"
+#include "ld.h"
+#include "mlComp.h"
+#include "append.h"
+
+void rehash(ProfileIndex *pi);
+unsigned int hashProfile(int *profile);
+void appendContigs(Args *args, ProfileIndex *pi, Profile *newPro, int numNewPro);
+void addCounts(Args *args, ProfileIndex *pi, Profile *newPro);
+
+void appendDb(Args *args){
+  ProfileIndex *pi;
+  Profile *oldPro, *newPro;
+  int numOld, numNew;
+  uint64_t oldSum;
+
+  oldSum = hashSum(args->n);
+  oldPro = loadProfiles(args->n, &numOld);
+  newPro = loadProfiles(args->a, &numNew);
+  pi = newProfileIndex(oldPro, numOld);
+  if(args->A)
+    addCounts(args, pi, newPro);
+  else
+    appendContigs(args, pi, newPro, numNew);
+  writeProfiles(args->n, pi->profiles, pi->n, args->Z);
+  carryLik(args->n, oldSum);
+  printf("#Appended %s to %s; %d profiles, %d new\n",args->a,args->n,pi->n,pi->n-numOld);
+  free(pi->profiles);
+  free(pi->slots);
+  free(pi);
+  free(newPro);
+}
+
+/* appendContigs: add the contigs of args->a after those of args->n;
+ * the positions are written to a new file, which replaces the old 
+ * one once complete 
+ */
+void appendContigs(Args *args, ProfileIndex *pi, Profile *newPro, int numNewPro){
+  FILE *oldFp, *in, *out;
+  Position *pb;
+  int *oldLen, *newLen, *map;
+  int i, j, numOld, numNew, max, oldWide, inWide, outWide;
+  char *fileName, *tmpName;
+
+  map = (int *)emalloc((numNewPro+1)*sizeof(int));
+  for(i=0;i<numNewPro;i++){
+    map[i] = lookupProfile(pi, newPro[i].profile);
+    pi->profiles[map[i]].n += newPro[i].n;
+  }
+  oldLen = readContigLengths(args->n, &numOld);
+  newLen = readContigLengths(args->a, &numNew);
+  max = 0;
+  for(i=0;i<numOld;i++)
+    if(oldLen[i] > max)
+      max = oldLen[i];
+  for(i=0;i<numNew;i++)
+    if(newLen[i] > max)
+      max = newLen[i];
+  pb = (Position *)emalloc((max+1)*sizeof(Position));
+  tmpName = (char *)emalloc(256*sizeof(char));
+  tmpName = strcpy(tmpName,args->n);
+  tmpName = strcat(tmpName,".tmp");
+  oldFp = openPos(args->n, "rb", &oldWide);
+  in = openPos(args->a, "rb", &inWide);
+  outWide = oldWide || inWide;
+  out = openPos(tmpName, "wb", &outWide);
+  for(i=0;i<numOld;i++){
+    readContig(oldFp, pb, oldLen[i], oldWide);
+    writePositions(out, pb, oldLen[i], outWide);
+  }
+  for(i=0;i<numNew;i++){
+    readContig(in, pb, newLen[i], inWide);
+    for(j=0;j<newLen[i];j++)
+      pb[j].pro = map[pb[j].pro];
+    writePositions(out, pb, newLen[i], outWide);
+  }
+  fclose(oldFp);
+  fclose(in);
+  fclose(out);
+  fileName = (char *)emalloc(256*sizeof(char));
+  fileName = strcpy(fileName,args->n);
+  fileName = strcat(fileName,".pos");
+  tmpName = strcat(tmpName,".pos");
+  if(rename(tmpName,fileName) != 0)
+    eprintf("rename(%s, %s) failed:",tmpName,fileName);
+  free(fileName);
+  free(tmpName);
+  oldLen = (int *)erealloc(oldLen,(numOld+numNew+1)*sizeof(int));
+  for(i=0;i<numNew;i++)
+    oldLen[numOld+i] = newLen[i];
+  writeContigLengths(args->n, oldLen, numOld+numNew);
+  free(pb);
+  free(map);
+  free(oldLen);
+  free(newLen);
+}
+
+/* addCounts: add the profiles of args->a to those of args->n
+ * site by site; contigs are matched by rank, sites by position
+ */
+void addCounts(Args *args, ProfileIndex *pi, Profile *newPro){
+  FILE *oldFp, *newFp, *out;
+  Position *ob, *nb, *mb;
+  int *oldLen, *newLen, *len;
+  int i, j, k, l, m, numOld, numNew, numCon, max, lo, ln, id;
+  int oldWide, newWide, outWide;
+  int p[4];
+  char *fileName, *tmpName;
+
+  oldLen = readContigLengths(args->n, &numOld);
+  newLen = readContigLengths(args->a, &numNew);
+  numCon = numOld > numNew ? numOld : numNew;
+  len = (int *)emalloc((numCon+1)*sizeof(int));
+  max = 0;
+  for(i=0;i<numOld;i++)
+    if(oldLen[i] > max)
+      max = oldLen[i];
+  for(i=0;i<numNew;i++)
+    if(newLen[i] > max)
+      max = newLen[i];
+  ob = (Position *)emalloc((max+1)*sizeof(Position));
+  nb = (Position *)emalloc((max+1)*sizeof(Position));
+  mb = (Position *)emalloc((2*(size_t)max+1)*sizeof(Position));
+  tmpName = (char *)emalloc(256*sizeof(char));
+  tmpName = strcpy(tmpName,args->n);
+  tmpName = strcat(tmpName,".tmp");
+  oldFp = openPos(args->n, "rb", &oldWide);
+  newFp = openPos(args->a, "rb", &newWide);
+  outWide = oldWide || newWide;
+  out = openPos(tmpName, "wb", &outWide);
+  for(i=0;i<numCon;i++){
+    lo = i < numOld ? oldLen[i] : 0;
+    ln = i < numNew ? newLen[i] : 0;
+    if((long)lo + ln > INT_MAX)
+      eprintf("contig %d may exceed %d sites, the maximum length of a contig.",i+1,INT_MAX);
+    readContig(oldFp, ob, lo, oldWide);
+    readContig(newFp, nb, ln, newWide);
+    j = k = m = 0;
+    while(j < lo || k < ln){
+      if(k == ln || (j < lo && ob[j].pos < nb[k].pos)){
+	mb[m++] = ob[j++];   /* old site only */
+	continue;
+      }
+      for(l=0;l<4;l++)
+	p[l] = newPro[nb[k].pro].profile[l];
+      if(j < lo && ob[j].pos == nb[k].pos){ /* site in both */
+	for(l=0;l<4;l++)
+	  p[l] += pi->profiles[ob[j].pro].profile[l];
+	pi->profiles[ob[j].pro].n--;
+	j++;
+      }
+      id = lookupProfile(pi, p);
+      pi->profiles[id].n++;
+      mb[m].pos = nb[k].pos;
+      mb[m].pro = id;
+      m++;
+      k++;
+    }
+    writePositions(out, mb, m, outWide);
+    len[i] = m;
+  }
+  fclose(oldFp);
+  fclose(newFp);
+  fclose(out);
+  fileName = (char *)emalloc(256*sizeof(char));
+  fileName = strcpy(fileName,args->n);
+  fileName = strcat(fileName,".pos");
+  tmpName = strcat(tmpName,".pos");
+  if(rename(tmpName,fileName) != 0)
+    eprintf("rename(%s, %s) failed:",tmpName,fileName);
+  writeContigLengths(args->n, len, numCon);
+  free(fileName);
+  free(tmpName);
+  free(ob);
+  free(nb);
+  free(mb);
+  free(len);
+  free(oldLen);
+  free(newLen);
+}
+
+ProfileIndex *newProfileIndex(Profile *profiles, int n){
+  ProfileIndex *pi;
+
+  pi = (ProfileIndex *)emalloc(sizeof(ProfileIndex));
+  pi->profiles = profiles;
+  pi->n = n;
+  pi->max = n > 0 ? n : 1;
+  pi->numSlots = 0;
+  pi->slots = NULL;
+  rehash(pi);
+  return pi;
+}
+
+/* lookupProfile: return the index of profile; a profile not seen 
+ * before is added with zero occurrences 
+ */
+int lookupProfile(ProfileIndex *pi, int *profile){
+  unsigned int h;
+  int i, id;
+
+  h = hashProfile(profile) & (pi->numSlots-1);
+  while((id = pi->slots[h]) != -1){
+    for(i=0;i<4;i++)
+      if(pi->profiles[id].profile[i] != profile[i])
+	break;
+    if(i == 4)
+      return id;
+    h = (h+1) & (pi->numSlots-1);
+  }
+  if(pi->n == pi->max){
+    pi->max *= 2;
+    pi->profiles = (Profile *)erealloc(pi->profiles,pi->max*sizeof(Profile));
+  }
+  id = pi->n++;
+  for(i=0;i<4;i++)
+    pi->profiles[id].profile[i] = profile[i];
+  pi->profiles[id].n = 0;
+  pi->slots[h] = id;
+  if(2*pi->n > pi->numSlots)
+    rehash(pi);
+  return id;
+}
+
+/* rehash: double the number of slots */
+void rehash(ProfileIndex *pi){
+  unsigned int h;
+  int i;
+
+  pi->numSlots = pi->numSlots ? 2*pi->numSlots : 1024;
+  while(pi->numSlots < 2*pi->max)
+    pi->numSlots *= 2;
+  pi->slots = (int *)erealloc(pi->slots,pi->numSlots*sizeof(int));
+  for(i=0;i<pi->numSlots;i++)
+    pi->slots[i] = -1;
+  for(i=0;i<pi->n;i++){
+    h = hashProfile(pi->profiles[i].profile) & (pi->numSlots-1);
+    while(pi->slots[h] != -1)
+      h = (h+1) & (pi->numSlots-1);
+    pi->slots[h] = i;
+  }
+}
+
+unsigned int hashProfile(int *profile){
+  unsigned int h;
+  int i;
+
+  h = 0;
+  for(i=0;i<4;i++)
+    h = (h ^ (unsigned int)profile[i]) * 2654435761u;
+  return h ^ (h >> 16);
+}
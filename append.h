@@ -0,0 +1,22 @@
+/***** append.h ***********************************
+ * Description: Header file for append.c.
+ * License: GNU General Public
+ **************************************************/
+#ifndef APPEND
+#define APPEND
+#include "interface.h"
+#include "profile.h"
+
+typedef struct profileIndex{ /* hash of profiles: */
+  Profile *profiles;         /* profiles */
+  int n;                     /* number of profiles */
+  int max;                   /* number of profiles allocated */
+  int *slots;                /* hash slots holding profile index or -1 */
+  int numSlots;              /* number of slots, a power of two */
+}ProfileIndex;
+
+void appendDb(Args *args);
+ProfileIndex *newProfileIndex(Profile *profiles, int n);
+int lookupProfile(ProfileIndex *pi, int *profile);
+
+#endif
@@ -0,0 +1,109 @@
+/***** bins.c *************************************
+ * Description: Adaptive distance classes. The 
+ *   pairs at all distances are counted in a 
+ *   single pass, and neighbouring distances are 
+ *   merged until each class holds a target number
+ *   of pairs. Delta is estimated once per class
+ *   from the pooled pairs and converted to rho at
+ *   their mean distance.
+ * License: GNU General Public
+ **************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include "eprintf.h"
+#include "interface.h"
+#include "ld.h"
+#include "profile.h"
+#include "profileTree.h"
+#include "mlComp.h"
+#include "joint.h"
+#include "trace.h"
+#include "bins.h"
+
+int *binStarts(JointPairs *jp, int target, int *numBins);
+
+/* runBins: count the pairs at distances m, m+S, ..., M together
+ * and estimate delta and rho in adaptive distance classes 
+ */
+void runBins(ContigDescr *contigDescr, FILE *fp, Args *args, Result *result){
+  JointPairs *jp;
+  int numDist;
+
+  numDist = (args->M - args->m) / args->S + 1;
+  if(numDist < 1)
+    return;
+  jp = countJointPairs(contigDescr, fp, args->m, args->S, numDist);
+  fitBins(jp, getNumProfiles(), args, result);
+  freeJointPairs(jp);
+}
+
+/* fitBins: estimate delta and rho in the distance classes of jp 
+ * holding at least args->W pairs each 
+ */
+void fitBins(JointPairs *jp, int numProfiles, Args *args, Result *result){
+  ProfilePairs pp;
+  char *outStr;
+  int i, k, lo, hi, numBins, *start;
+  double n, dist;
+
+  outStr = "%d\t%d\t%.1f\t%.0f\t%8.2e\t%8.2e<%8.2e<%8.2e\t%8.2e<%8.2e<%8.2e\n";
+  pp.numProfiles = numProfiles;
+  pp.trees = NULL;
+  pp.dense = NULL;
+  pp.pt = NULL;
+  pp.sp = NULL;
+  pp.jp = jp;
+  start = binStarts(jp, args->W, &numBins);
+  printf("#Distance classes of at least %d pairs\n",args->W);
+  printf("from\tto\td\tn\t-log(L)\t\tdelta\t\t\t\trho\n");
+  for(i=0;i<numBins;i++){
+    lo = start[i];
+    hi = start[i+1];
+    n = dist = 0.;
+    for(k=lo;k<hi;k++){
+      n += jp->numPos[k];
+      dist += jp->numPos[k] * (jp->first + k*jp->step);
+    }
+    if(n == 0.)
+      continue;
+    dist /= n;
+    pp.col = lo;
+    pp.numCol = hi - lo;
+    traceBegin("distanceClass", jp->first + lo*jp->step);
+    result = estimateDelta(&pp, numProfiles, args, result, dist);
+    traceEnd();
+    printf(outStr,jp->first+lo*jp->step,jp->first+(hi-1)*jp->step,dist,n,
+	   result->l,result->dLo,result->de,result->dUp,result->rLo,result->rh,result->rUp);
+    fflush(NULL);
+  }
+  free(start);
+}
+
+/* binStarts: first distance of each class, plus the end of the 
+ * last; a class grows until it holds target pairs, and a short 
+ * last class joins the one before it 
+ */
+int *binStarts(JointPairs *jp, int target, int *numBins){
+  int k, m, *start;
+  double n;
+
+  start = (int *)emalloc((jp->numDist+2)*sizeof(int));
+  m = 0;
+  n = 0.;
+  start[0] = 0;
+  for(k=0;k<jp->numDist;k++){
+    n += jp->numPos[k];
+    if(n >= target){
+      start[++m] = k + 1;
+      n = 0.;
+    }
+  }
+  if(start[m] < jp->numDist){
+    if(m > 0)
+      start[m] = jp->numDist;
+    else
+      start[++m] = jp->numDist;
+  }
+  *numBins = m;
+  return start;
+}
@@ -0,0 +1,15 @@
+/***** bins.h *************************************
+ * Description: Header file for bins.c.
+ * License: GNU General Public
+ **************************************************/
+#ifndef BINS
+#define BINS
+#include <stdio.h>
+#include "interface.h"
+#include "ld.h"
+#include "mlComp.h"
+#include "joint.h"
+
+void runBins(ContigDescr *contigDescr, FILE *fp, Args *args, Result *result);
+void fitBins(JointPairs *jp, int numProfiles, Args *args, Result *result);
+#endif
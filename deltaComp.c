@@ -19,20 +19,22 @@
 #include "mlComp.h"
 #include "eprintf.h"
 #include "profile.h"
+#include "kernel.h"
+#include "trace.h"
 
 double globalPi, globalEpsilon;
-int globalDist;
-Node **globalProfilePairs;
+double globalDist;
+ProfilePairs *globalProfilePairs;
 int globalNumProfiles;
 double likelihood;
 
-double rhoFromDelta(double t, double d);
 void lik(double de);
 double myF(const gsl_vector *v, void *params);
 double confFun(double x, void *params);
 void conf(Args *args, Result *result);
 double iterate(Args *args, gsl_root_fsolver *s, double xLo, double xHi);
-void traverse(int a, Node *np, double h0, double h2, double complementHalf);
+void traverse(int a, Node *np, double *h0, double *h2, double *complementHalf, int k, double *l);
+void likH(double *h0, double *h2, double *complementHalf, int k, double *l);
 
 /* estimateDelta: estimate pi, delta, and epsilon using 
  * the Nelder-Mead Simplex algorithm; code adapted 
@@ -41,7 +43,7 @@ void traverse(int a, Node *np, double h0, double h2, double complementHalf);
  * Scientific Library Reference Manual. Edition 1.6, 
  * for GSL Version 1.6, 17 March 2005, p 472f.
  */
-Result *estimateDelta(Node **profilePairs, int numProfiles, Args *args, Result *result, int dist){
+Result *estimateDelta(ProfilePairs *profilePairs, int numProfiles, Args *args, Result *result, double dist){
   const gsl_multimin_fminimizer_type *T;
   gsl_multimin_fminimizer *s;
   gsl_vector *ss, *x;
@@ -62,7 +64,7 @@ Result *estimateDelta(Node **profilePairs, int numProfiles, Args *args, Result *
   /* initialize vertex size vector */
   ss = gsl_vector_alloc(numPara);
   /* set all step sizes */
-  gsl_vector_set_all(ss, args->s);
+  gsl_vector_set_all(ss, args->s > 0 ? args->s : STEP_SIZE);
   /* starting point */
   x = gsl_vector_alloc(numPara);
   gsl_vector_set(x, 0, args->D);
@@ -74,7 +76,9 @@ Result *estimateDelta(Node **profilePairs, int numProfiles, Args *args, Result *
   gsl_multimin_fminimizer_set(s, &minex_func, x, ss);
   do{
     iter++;
+    traceBegin("fitIteration", iter);
     status = gsl_multimin_fminimizer_iterate(s);
+    traceEnd();
     if(status)
       break;
     size = gsl_multimin_fminimizer_size(s);
@@ -86,9 +90,13 @@ Result *estimateDelta(Node **profilePairs, int numProfiles, Args *args, Result *
   result->l = s->fval;
   result->i = iter;
   result->rh = rhoFromDelta(result->pi,result->de)/dist;
-  conf(args, result);
-  result->rLo = rhoFromDelta(result->pi,result->dLo)/dist;
-  result->rUp = rhoFromDelta(result->pi,result->dUp)/dist;
+  if(!args->b && !args->j && args->x == 0.){ /* otherwise intervals come from resampling */
+    traceBegin("conf", (long)dist);
+    conf(args, result);
+    traceEnd();
+    result->rLo = rhoFromDelta(result->pi,result->dLo)/dist;
+    result->rUp = rhoFromDelta(result->pi,result->dUp)/dist;
+  }
   gsl_vector_free(x);
   gsl_vector_free(ss);
   gsl_multimin_fminimizer_free(s);
@@ -111,43 +119,103 @@ double myF(const gsl_vector* v, void *params){
 }
 
 void lik(double de){
-  int i;
-  double pi, h0, h2;
+  double h0, h2;
   double complementHalf;
 
-  pi = globalPi;
-  h0 = 1./(1.+pi)/(1.+pi) + de*pi/(1.+pi)/(1.+pi);
-  h2 = pi*pi/(1.+pi)/(1.+pi) + de*pi/(1.+pi)/(1.+pi);
-  complementHalf = (1.-h0-h2)/2.;
+  compH(globalPi, de, &h0, &h2, &complementHalf);
   likelihood = 0.;
-  for(i=0;i<globalNumProfiles;i++)
-    traverse(i,globalProfilePairs[i],h0,h2,complementHalf);
-  
+  likH(&h0, &h2, &complementHalf, 1, &likelihood);
+}
+
+/* likDeltas: log-likelihoods l[0],...,l[k-1] of the pair counts 
+ * at k values of delta in a single pass over the counts 
+ */
+void likDeltas(ProfilePairs *profilePairs, int numProfiles, double pi, double *de, int k, double *l){
+  double *h0, *h2, *complementHalf;
+  int i;
+
+  globalProfilePairs = profilePairs;
+  globalNumProfiles = numProfiles;
+  h0 = (double *)emalloc(3*k*sizeof(double));
+  h2 = h0 + k;
+  complementHalf = h2 + k;
+  for(i=0;i<k;i++){
+    compH(pi, de[i], &h0[i], &h2[i], &complementHalf[i]);
+    l[i] = 0.;
+  }
+  likH(h0, h2, complementHalf, k, l);
+  free(h0);
+}
+
+/* likH: add the log-likelihoods of the pair counts under k sets 
+ * of pair probabilities to l[0],...,l[k-1] 
+ */
+void likH(double *h0, double *h2, double *complementHalf, int k, double *l){
+  int i;
+
+  traceBegin("lik", k);
+  if(globalProfilePairs->jp)
+    jointLik(globalProfilePairs->jp, globalProfilePairs->col, globalProfilePairs->numCol, h0, h2, complementHalf, k, l);
+  else if(globalProfilePairs->dense)
+    pairTableLikAll(globalProfilePairs->pt, getLones(), getLtwos(), getLscales(),
+		    h0, h2, complementHalf, k, l);
+  else if(globalProfilePairs->sp)
+    spillLik(globalProfilePairs->sp, getLones(), getLtwos(), getLscales(),
+	     h0, h2, complementHalf, k, l);
+  else
+    for(i=0;i<globalNumProfiles;i++)
+      traverse(i,globalProfilePairs->trees[i],h0,h2,complementHalf,k,l);
+  traceEnd();
+}
+
+/* writeLikSurface: write -log(L) on a grid of SURFACE_POINTS values
+ * of delta between -1 and 1, given the estimates of pi in result 
+ */
+void writeLikSurface(FILE *fp, ProfilePairs *profilePairs, int numProfiles, Result *result, int dist){
+  double de[SURFACE_POINTS], l[SURFACE_POINTS];
+  int i;
+
+  for(i=0;i<SURFACE_POINTS;i++)
+    de[i] = -1. + 2.*i/(SURFACE_POINTS-1);
+  likDeltas(profilePairs, numProfiles, result->pi, de, SURFACE_POINTS, l);
+  for(i=0;i<SURFACE_POINTS;i++)
+    fprintf(fp,"%d\t%.4f\t%.8e\n",dist,de[i],-l[i]);
 }
 
+/* compH: probabilities of zero and two heterozygous sites in a pair, 
+ * and half the remaining probability, given pi and delta 
+ */
+void compH(double pi, double de, double *h0, double *h2, double *complementHalf){
+  *h0 = 1./(1.+pi)/(1.+pi) + de*pi/(1.+pi)/(1.+pi);
+  *h2 = pi*pi/(1.+pi)/(1.+pi) + de*pi/(1.+pi)/(1.+pi);
+  *complementHalf = (1.-*h0-*h2)/2.;
+}
 
-void traverse(int a, Node *np, double h0, double h2, double complementHalf){
-  double li;
-  int b;
-  double *lOnes, *lTwos;
+KERNEL void traverse(int a, Node *np, double *h0, double *h2, double *complementHalf, int k, double *l){
+  double li, p11, p22, p12, sc;
+  int b, j;
+  double *lOnes, *lTwos, *lScales;
 
   if(np != NULL){
-    traverse(a,np->left,h0,h2,complementHalf);
+    traverse(a,np->left,h0,h2,complementHalf,k,l);
 
     lOnes = getLones();
     lTwos = getLtwos();
+    lScales = getLscales();
     b = np->key;
-    li = h0*lOnes[a]*lOnes[b]
-       + h2*lTwos[a]*lTwos[b]
-       + complementHalf*(lOnes[a]*lTwos[b]+lTwos[a]*lOnes[b]);
-    if(li>0){
-      /* printf("li: %f\n",li); */
-      /* printf("np->n: %f\n",log(li)*np->n); */
-      likelihood += log(li) * np->n;
-    }else
-      likelihood += log(DBL_MIN) * np->n;
-
-    traverse(a,np->right,h0,h2,complementHalf);
+    p11 = lOnes[a]*lOnes[b];
+    p22 = lTwos[a]*lTwos[b];
+    p12 = lOnes[a]*lTwos[b]+lTwos[a]*lOnes[b];
+    sc = lScales[a] + lScales[b];
+    for(j=0;j<k;j++){
+      li = h0[j]*p11 + h2[j]*p22 + complementHalf[j]*p12;
+      if(li>0)
+	l[j] += (log(li) + sc) * np->n;
+      else
+	l[j] += (log(DBL_MIN) + sc) * np->n;
+    }
+
+    traverse(a,np->right,h0,h2,complementHalf,k,l);
   }
 }
 
@@ -171,13 +239,15 @@ void conf(Args *args, Result *result){
   int status;
 
   /* preliminaries */
+  result->type = 2;
+  if(args->q && curvBounds(confFun, result, result->de, -1., 1., &result->dLo, &result->dUp))
+    return;
   gsl_set_error_handler_off();
   fun.function = &confFun;
   fun.params = result;
   solverType = gsl_root_fsolver_brent;
   s = gsl_root_fsolver_alloc(solverType);
   /* search for lower bound of delta */
-  result->type = 2;
   if(result->de < 0)
     xLo = -1;
   else
@@ -223,6 +293,18 @@ void setPi(double pi){
   globalPi = pi;
 }
 
+/* deltaFromRho: inverse of rhoFromDelta; the delta at which 
+ * rhoFromDelta(t,delta) is r 
+ */
+double deltaFromRho(double t, double r){
+  double p, q;
+
+  p = 9. + 36.*t + 47.*pow(t,2.) + 24.*pow(t,3.) + 4.*pow(t,4.);
+  q = 9. + 9.*t + 2.*pow(t,2.);
+  return t*((1. + t)*r + 2.*q)/
+    ((1. + t)*pow(r,2.) + (13. + 19.*t + 6.*pow(t,2.))*r + 2.*p/(1. + t));
+}
+
 double rhoFromDelta(double t, double d){
   double r;
 
@@ -10,22 +10,56 @@
 #include <assert.h>
 #include <limits.h>
 #include <unistd.h>
+#include <getopt.h>
 #include "interface.h"
 #include "eprintf.h"
+#include "kernel.h"
 
 Args *args;
 
 Args *getArgs(int argc, char *argv[]){
   int c;
-  char *optString = "P:E:D:R:t:s:i:hpM:lLm:S:n:I";
+  char *optString = "P:E:D:R:t:s:i:hpM:lLm:S:n:Ib:jB:c:z:w:Co:fa:AOk:G:g:J:x:y:uq:v:VNK:X:W:Q:Z";
+  static struct option longOptions[] = {
+    {"bootstrap",  required_argument, NULL, 'b'},
+    {"jackknife",  no_argument,       NULL, 'j'},
+    {"block-size", required_argument, NULL, 'B'},
+    {"threads",    required_argument, NULL, 'c'},
+    {"seed",       required_argument, NULL, 'z'},
+    {"window",     required_argument, NULL, 'w'},
+    {"per-contig", no_argument,       NULL, 'C'},
+    {"map",        required_argument, NULL, 'o'},
+    {"float",      no_argument,       NULL, 'f'},
+    {"append",     required_argument, NULL, 'a'},
+    {"add-counts", no_argument,       NULL, 'A'},
+    {"reorder",    no_argument,       NULL, 'O'},
+    {"dense-mem",  required_argument, NULL, 'k'},
+    {"mem-limit",  required_argument, NULL, 'G'},
+    {"lik-surface",required_argument, NULL, 'g'},
+    {"joint",      required_argument, NULL, 'J'},
+    {"sample",     required_argument, NULL, 'x'},
+    {"sample-reps",required_argument, NULL, 'y'},
+    {"unordered",  no_argument,       NULL, 'u'},
+    {"ci",         required_argument, NULL, 'q'},
+    {"trace",      required_argument, NULL, 'v'},
+    {"trace-counters", no_argument,   NULL, 'V'},
+    {"stream",     no_argument,       NULL, 'N'},
+    {"min-cov",    required_argument, NULL, 'K'},
+    {"max-cov",    required_argument, NULL, 'X'},
+    {"bin-pairs",  required_argument, NULL, 'W'},
+    {"rho-fit",    required_argument, NULL, 'Q'},
+    {"pack-sum",   no_argument,       NULL, 'Z'},
+    {NULL, 0, NULL, 0}
+  };
 
   args = (Args *)emalloc(sizeof(Args));
   args->P = INI_PI;
   args->E = INI_EPSILON;
   args->D = INI_DELTA;
+  args->R = INI_RHO;
   args->t = THRESHOLD;
   args->n = DEFAULT_N;
-  args->s = STEP_SIZE;
+  args->s = 0.;
   args->S = DEFAULT_S;
   args->i = MAX_IT;
   args->I = 0;
@@ -36,19 +70,53 @@ Args *getArgs(int argc, char *argv[]){
   args->h = 0;
   args->e = 0;
   args->p = 0;
+  args->b = 0;
+  args->j = 0;
+  args->B = 0;
+  args->c = DEFAULT_C;
+  args->z = DEFAULT_Z;
+  args->w = 0;
+  args->C = 0;
+  args->o = NULL;
+  args->f = 0;
+  args->a = NULL;
+  args->A = 0;
+  args->O = 0;
+  args->Z = 0;
+  args->k = DEFAULT_K;
+  args->G = 0;
+  args->g = NULL;
+  args->J = 0;
+  args->x = 0.;
+  args->y = DEFAULT_Y;
+  args->u = 0;
+  args->q = 0;
+  args->F = 1;
+  args->v = NULL;
+  args->V = 0;
+  args->N = 0;
+  args->K = 0;
+  args->X = INT_MAX;
+  args->W = 0;
+  args->Q = 0;
 
-  c = getopt(argc, argv, optString);
+  c = getopt_long(argc, argv, optString, longOptions, NULL);
   while(c != -1){
     switch(c){
     case 'P':                           /* initial value of pi */
       args->P = atof(optarg);
+      args->F = 0;
       break;
     case 'E':                           /* initial error rate, epsilon */
       args->E = atof(optarg);
+      args->F = 0;
       break;
     case 'D':                           /* initial disequilibrium coefficient, delta */
       args->D = atof(optarg);
       break;
+    case 'R':                           /* initial rho in the joint fit */
+      args->R = atof(optarg);
+      break;
     case 'n':                           /* name of database */
       args->n = optarg;
       break;
@@ -82,6 +150,106 @@ Args *getArgs(int argc, char *argv[]){
     case 'L':                           /* lump "step" distance classes? */
       args->L = 1;
       break;
+    case 'b':                           /* number of block-bootstrap replicates */
+      args->b = atoi(optarg);
+      break;
+    case 'j':                           /* block-jackknife */
+      args->j = 1;
+      break;
+    case 'B':                           /* number of sites per resampling block */
+      args->B = atoi(optarg);
+      break;
+    case 'c':                           /* number of threads */
+      args->c = atoi(optarg);
+      if(args->c < 1)
+	args->c = 1;
+      break;
+    case 'z':                           /* seed for random number generator */
+      args->z = strtoul(optarg, NULL, 10);
+      break;
+    case 'w':                           /* window size in regional analysis */
+      args->w = atoi(optarg);
+      break;
+    case 'C':                           /* regional analysis per contig */
+      args->C = 1;
+      break;
+    case 'o':                           /* recombination map */
+      args->o = optarg;
+      break;
+    case 'f':                           /* single precision fast path */
+      args->f = 1;
+      break;
+    case 'a':                           /* append database */
+      args->a = optarg;
+      break;
+    case 'A':                           /* appended database adds reads to existing contigs */
+      args->A = 1;
+      break;
+    case 'O':                           /* renumber profiles by frequency */
+      args->O = 1;
+      break;
+    case 'Z':                           /* write profiles in the packed format */
+      args->Z = 1;
+      break;
+    case 'k':                           /* maximum memory for dense pair counts */
+      args->k = atoi(optarg);
+      break;
+    case 'G':                           /* memory limit for pair counts */
+      args->G = atoi(optarg);
+      break;
+    case 'g':                           /* likelihood surface of delta */
+      args->g = optarg;
+      break;
+    case 'J':                           /* distances counted together */
+      args->J = atoi(optarg);
+      break;
+    case 'x':                           /* fraction of sites sampled */
+      args->x = atof(optarg);
+      break;
+    case 'y':                           /* number of subsamples */
+      args->y = atoi(optarg);
+      break;
+    case 'u':                           /* unordered parallel sums */
+      args->u = 1;
+      break;
+    case 'q':                           /* type of likelihood intervals */
+      if(strcmp(optarg, "curvature") == 0)
+	args->q = 1;
+      else if(strcmp(optarg, "root") == 0)
+	args->q = 0;
+      else{
+	printf("# unknown type of intervals: %s\n", optarg);
+	args->e = 1;
+      }
+      break;
+    case 'v':                           /* trace file */
+      args->v = optarg;
+      break;
+    case 'V':                           /* hardware counters in trace */
+      args->V = 1;
+      break;
+    case 'N':                           /* read profiles from stdin */
+      args->N = 1;
+      break;
+    case 'K':                           /* minimum coverage */
+      args->K = atoi(optarg);
+      break;
+    case 'X':                           /* maximum coverage */
+      args->X = atoi(optarg);
+      break;
+    case 'W':                           /* pairs per adaptive distance class */
+      args->W = atoi(optarg);
+      break;
+    case 'Q':                           /* model of the joint fit of rho */
+      if(strcmp(optarg, "const") == 0)
+	args->Q = RHO_CONST;
+      else if(strcmp(optarg, "power") == 0)
+	args->Q = RHO_POWER;
+      else{
+	printf("# unknown model of rho: %s\n", optarg);
+	args->e = 1;
+      }
+      break;
     case 'p':                           /* print program information */
       args->p = 1;
       break;
@@ -94,7 +262,24 @@ Args *getArgs(int argc, char *argv[]){
       args->e = 1;
       return args;
     }
-    c = getopt(argc, argv, optString);
+    c = getopt_long(argc, argv, optString, longOptions, NULL);
+  }
+  if(args->h || args->e)
+    return args;
+  /* joint fits of rho and adaptive distance classes */
+  if(args->Q){
+    if(args->M == INT_MAX)
+      eprintf("the joint fit of rho needs a maximum distance; please use -M.");
+    if(args->m < 1)
+      eprintf("the joint fit of rho needs distances of at least 1; please use -m 1 or more.");
+    if(args->L || args->b || args->j || args->W)
+      eprintf("the joint fit of rho cannot be combined with -L, -b, -j, or -W.");
+  }
+  if(args->W){
+    if(args->M == INT_MAX)
+      eprintf("adaptive distance classes need a maximum distance; please use -M.");
+    if(args->L || args->b || args->j)
+      eprintf("adaptive distance classes cannot be combined with -L, -b, or -j.");
   }
   return args;
 }
@@ -109,18 +294,56 @@ void printUsage(char *version){
   printf("\t[-m <NUM> minimum distance analyzed in rho computation; default: 1]\n");
   printf("\t[-M <NUM> maximum distance analyzed in rho computation; default: all]\n");
   printf("\t[-S <NUM> step size in rho computation; default: %d]\n",DEFAULT_S);
-  printf("\t[-I write likelihoods to file; default: likelihoods not written to file]\n");
+  printf("\t[-I recompute the likelihoods of theta and store them in the cache <FILE>.lik;\n");
+  printf("\t\tdefault: reuse the cache if it holds the database and parameters, add them to it otherwise]\n");
   printf("\t[-L lump -S distance classes; default: no lumping]\n");
   printf("\t\tdefault: use initial estimates of \\epsilon and \\theta]\n");
+  printf("\t[-W, --bin-pairs <NUM> merge neighbouring distances into classes of at least NUM pairs,\n");
+  printf("\t\tcounted in a single pass; needs -M; default: one class per distance]\n");
+  printf("\t[-Q, --rho-fit <MODEL> fit one rho to all distances jointly (const), or rho(d) = rho*(d/m)^b\n");
+  printf("\t\t(power); needs -M; default: one fit per distance]\n");
+  printf("\t[-b, --bootstrap <NUM> confidence intervals of delta and rho from NUM block-bootstrap replicates;\n");
+  printf("\t\tdefault: likelihood intervals]\n");
+  printf("\t[-j, --jackknife confidence intervals of delta and rho from block-jackknife; default: likelihood intervals]\n");
+  printf("\t[-B, --block-size <NUM> number of sites per resampling block; default: one block per contig]\n");
+  printf("\t[-c, --threads <NUM> number of threads; default: %d]\n",DEFAULT_C);
+  printf("\t[-z, --seed <NUM> seed for random number generator; default: %d]\n",DEFAULT_Z);
+  printf("\t[-w, --window <NUM> estimate theta and rho in windows of NUM positions; needs -M]\n");
+  printf("\t[-C, --per-contig estimate theta and rho per contig; needs -M]\n");
+  printf("\t[-o, --map <FILE> write regional rho estimates to FILE as a recombination map]\n");
+  printf("\t[-g, --lik-surface <FILE> write -log(L) of delta at %d values between -1 and 1 to FILE]\n",SURFACE_POINTS);
+  printf("\t[-a, --append <FILE> append the contigs of database FILE to the database before analysis]\n");
+  printf("\t[-A, --add-counts with -a, add the counts in FILE to the existing contigs site by site]\n");
+  printf("\t[-O, --reorder renumber the profiles of the database by frequency before analysis]\n");
+  printf("\t[-Z, --pack-sum with -a or -O, write the profiles in the packed 16-bit format, which older\n");
+  printf("\t\treleases of mlRho cannot read; default: 32-bit format, or 64-bit if needed]\n");
+  printf("\t[-q, --ci <TYPE> likelihood intervals by root search (root) or from the curvature at the\n");
+  printf("\t\testimate (curvature), which falls back to root search; default: root]\n");
+  printf("\t[-x, --sample <NUM> quick look at fraction NUM of the sites; rho needs -M]\n");
+  printf("\t[-y, --sample-reps <NUM> number of subsamples with -x; default: %d]\n",DEFAULT_Y);
+  printf("\t[-N, --stream read profiles in formatPro input format from stdin instead of a database;\n");
+  printf("\t\trho needs -M]\n");
+  printf("\t[-K, --min-cov <NUM> analyze only the sites covered by at least NUM reads; default: all sites]\n");
+  printf("\t[-X, --max-cov <NUM> analyze only the sites covered by at most NUM reads; default: all sites]\n");
   printf("\t[-p print information about program and exit]\n");			     
   printf("\t[-h print this help message and exit]\n");
   printf("extra options:\n");
-  printf("\t[-P <NUM> initial theta value; default: %10.3e]\n",INI_PI);
-  printf("\t[-E <NUM> initial epsilon value; default: %10.3e]\n",INI_EPSILON);
+  printf("\t[-P <NUM> initial theta value; default: moment estimate, or %10.3e with -E]\n",INI_PI);
+  printf("\t[-E <NUM> initial epsilon value; default: moment estimate, or %10.3e with -P]\n",INI_EPSILON);
   printf("\t[-R <NUM> initial rho value; default: %10.3e]\n",INI_RHO);
   printf("\t[-D <NUM> initial delta value; default: %10.3e]\n",INI_DELTA);
+  printf("\t[-f, --float evaluate low-coverage sites in single precision when estimating theta]\n");
+  printf("\t[-k, --dense-mem <NUM> count pairs in a dense matrix if it fits into NUM MB; default: %d]\n",DEFAULT_K);
+  printf("\t[-J, --joint <NUM> count pairs for blocks of NUM distances together in memory, failing if they\n");
+  printf("\t\texceed -G; -k does not apply; default: one distance at a time]\n");
+  printf("\t[-G, --mem-limit <NUM> count pairs on disk if they do not fit into NUM MB; default: no limit]\n");
+  printf("\t[-u, --unordered faster parallel sums whose last digits depend on the number of threads;\n");
+  printf("\t\tdefault: sums independent of the number of threads]\n");
+  printf("\t[-v, --trace <FILE> write the phases of the run to FILE in Chrome trace format]\n");
+  printf("\t[-V, --trace-counters with -v, add cycles, cache misses and branch misses to each phase]\n");
   printf("\t[-t <NUM> simplex size threshold; default: %10.3e]\n",THRESHOLD);
-  printf("\t[-s <NUM> size of first step in ML estimation; default: %10.3e]\n",STEP_SIZE);
+  printf("\t[-s <NUM> size of first step in ML estimation; default: %10.3e;\n",STEP_SIZE);
+  printf("\t\twithout -s, theta and epsilon start from moment estimates with steps of %g times their values]\n",MOM_STEP);
   exit(0);
 }
 
@@ -145,6 +368,8 @@ void printSplash(char *version){
   printf("* Code maintained by Bernhard Haubold,                 *\n");
   printf("* haubold@evolbio.mpg.de                               *\n");
   printf("*                                                      *\n");
+  printf("* KERNELS %-44s *\n", kernelVariant());
+  printf("*                                                      *\n");
   printf("* LICENSE                                              *\n");
   printf("* This software is distributed under the GNU General   *\n");
   printf("* Public License. You should have received a copy      *\n");
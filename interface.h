@@ -13,9 +13,19 @@
 #define INI_RHO 1.
 #define THRESHOLD 1e-8
 #define STEP_SIZE 1e-4
+#define MOM_STEP 0.2    /* first step relative to the moment estimates */
+#define MOM_MIN 1e-6    /* smallest moment estimate of pi and ee */
+#define MOM_ITER 60     /* iterations of the moment estimator */
 #define MAX_IT 1000
 #define DEFAULT_S 1
 #define DEFAULT_N "profileDb"
+#define DEFAULT_C 1
+#define DEFAULT_Z 1
+#define DEFAULT_Y 5
+#define DEFAULT_K 256 /* maximum memory for dense pair counts, in MB */
+#define SURFACE_POINTS 201 /* values of delta on the likelihood surface */
+#define RHO_CONST 1 /* joint fit of one rho at all distances */
+#define RHO_POWER 2 /* joint fit of rho(d) = rho*(d/m)^b */
 
 /* define argument container */
 typedef struct args{
@@ -24,21 +34,50 @@ typedef struct args{
   double D; /* initial delta */
   double R; /* initial rho */
   double t; /* threshold of simplex size */
-  double s; /* step size in ML analysis */
+  double s; /* step size in ML analysis; 0 for the default */
   int S;    /* step size in LD analysis */
   int d;    /* distance for H0 and H2 computation */
   int i;    /* maximum number of iterations */
   int m;    /* minimum distance in LD analysis */
   int M;    /* maximum distance in LD analysis */
+  int b;    /* number of block-bootstrap replicates */
+  int B;    /* number of sites per resampling block; 0 for one block per contig */
+  int c;    /* number of threads */
+  int k;    /* maximum memory for dense pair counts in MB */
+  int G;    /* memory limit for pair counts in MB; 0 for no limit */
+  char *g;  /* file of likelihood surfaces of delta; or NULL */
+  int J;    /* number of distances counted together; 0 for one at a time */
+  int w;    /* window size in regional analysis */
+  int K;    /* minimum coverage of sites analyzed */
+  int X;    /* maximum coverage of sites analyzed */
+  int W;    /* minimum number of pairs per adaptive distance class; 0 for none */
+  unsigned long z; /* seed for random number generator */
+  double x; /* fraction of sites sampled; 0 for all sites */
+  int y;    /* number of subsamples */
   char l;   /* compute delta */
   char I;   /* print likelihood values */
   char L;   /* lump the number of distance classes indicated by "step"? */
+  char j;   /* block-jackknife confidence intervals? */
+  char C;   /* regional analysis per contig? */
+  char f;   /* single precision fast path in likelihood of theta? */
+  char A;   /* appended database holds further reads of the same contigs? */
+  char O;   /* renumber profiles by frequency? */
+  char Z;   /* write rewritten profiles in the packed format? */
+  char u;   /* unordered parallel sums? */
+  char q;   /* likelihood intervals from curvature? */
+  char F;   /* start theta and epsilon at their moment estimates? */
+  char V;   /* hardware counters in trace? */
+  char N;   /* read profiles from stdin? */
+  char Q;   /* model of the joint fit of rho; 0 for none */
   char r;   /* print profiles and exit */
   char p;   /* print program information */
   char T;   /* test mode */
   char h;   /* help message? */
   char e;   /* error message? */
   char *n;  /* name of database */
+  char *o;  /* name of recombination map written in regional analysis */
+  char *a;  /* name of database appended to database n */
+  char *v;  /* name of trace file; or NULL */
 } Args;
 
 Args *getArgs(int argc, char *argv[]);
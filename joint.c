@@ -0,0 +1,326 @@
+/***** joint.c ************************************
+ * Description: Count the pairs of a block of dis-
+ *   tances together. Each distinct pair is stored
+ *   once with one count per distance, and the
+ *   products of its site likelihoods, which do not
+ *   depend on delta or on the distance, are com-
+ *   puted once for the whole block.
+ * License: GNU General Public
+ **************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <float.h>
+#include <math.h>
+#include "eprintf.h"
+#include "interface.h"
+#include "ld.h"
+#include "pairTable.h"
+#include "reader.h"
+#include "mlComp.h"
+#include "joint.h"
+#include "reduce.h"
+#include "trace.h"
+#include "kernel.h"
+
+typedef struct jointLikData{ /* arguments of jointLikRange: */
+  JointPairs *jp;
+  size_t first;              /* first entry of the column */
+  double *h0, *h2, *complementHalf;
+  int k;
+}JointLikData;
+
+PairInt lookupPair(JointPairs *jp, uint64_t key);
+void rehashPairs(JointPairs *jp);
+uint64_t hashPair(uint64_t key);
+void jointLikRange(size_t lo, size_t hi, void *data, double *l);
+void jointLikColsRange(size_t lo, size_t hi, void *data, double *l);
+size_t jointMem(JointPairs *jp);
+
+size_t jointMemLimit = 0;  /* memory limit of the counts in bytes; 0 for none */
+
+/* setJointMemLimit: fail if the pair counts of a block of distances
+ * would need more than limit bytes; 0 for no limit 
+ */
+void setJointMemLimit(size_t limit){
+  jointMemLimit = limit;
+}
+
+/* jointMem: bytes held by the pair counts while counting */
+size_t jointMem(JointPairs *jp){
+  return jp->max*(sizeof(uint64_t) + jp->numDist*sizeof(CountInt)) 
+    + jp->numSlots*sizeof(PairInt);
+}
+
+/* countJointPairs: count the pairs at distances first, first+step,
+ * ..., first+(numDist-1)*step 
+ */
+JointPairs *countJointPairs(ContigDescr *contigDescr, FILE *fp, int first, int step, int numDist){
+  JointPairs *jp;
+  ContigReader *cr;
+  Position *pb;
+  uint64_t *keys;
+  int i, k, l, n, len, max;
+
+  jp = newJointPairs(first, step, numDist);
+  max = 0;
+  for(i=0;i<contigDescr->n;i++)
+    if(contigDescr->len[i] > max)
+      max = contigDescr->len[i];
+  keys = (uint64_t *)emalloc((max+1)*sizeof(uint64_t));
+  cr = openContigReader(contigDescr, fp);
+  for(i=0;i<contigDescr->n;i++){
+    pb = nextContig(cr, &len);
+    traceBegin("countJointPairs", i);
+    for(k=0;k<numDist;k++){
+      n = scanPairs(pb, len, 0, len, first + k*step, keys);
+      for(l=0;l<n;l++)
+	addJointPair(jp, keys[l], k);
+    }
+    traceEnd();
+  }
+  closeContigReader(cr);
+  free(keys);
+  finishJointPairs(jp);
+
+  return jp;
+}
+
+/* newJointPairs: empty counts of the pairs at distances first, 
+ * first+step, ..., first+(numDist-1)*step 
+ */
+JointPairs *newJointPairs(int first, int step, int numDist){
+  JointPairs *jp;
+
+  jp = (JointPairs *)emalloc(sizeof(JointPairs));
+  jp->first = first;
+  jp->step = step;
+  jp->numDist = numDist;
+  jp->n = 0;
+  jp->max = 1024;
+  jp->keys = (uint64_t *)emalloc(jp->max*sizeof(uint64_t));
+  jp->c = (CountInt *)emalloc((size_t)jp->max*numDist*sizeof(CountInt));
+  jp->numSlots = 0;
+  jp->slots = NULL;
+  rehashPairs(jp);
+
+  return jp;
+}
+
+/* addJointPair: count the pair key at the k-th distance */
+void addJointPair(JointPairs *jp, uint64_t key, int k){
+  PairInt id;
+
+  id = lookupPair(jp, key);  /* may move jp->c */
+  jp->c[(size_t)id*jp->numDist+k]++;
+}
+
+/* lookupPair: index of pair key; new pairs are added with zero
+ * counts 
+ */
+PairInt lookupPair(JointPairs *jp, uint64_t key){
+  size_t h;
+  PairInt id;
+  int i;
+
+  h = hashPair(key) & (jp->numSlots-1);
+  while((id = jp->slots[h]) != -1){
+    if(jp->keys[id] == key)
+      return id;
+    h = (h+1) & (jp->numSlots-1);
+  }
+  if(jp->n == jp->max){
+    if(jp->n == PAIR_MAX)
+      eprintf("more than %" PRId64 " distinct pairs; please use a 64-bit build of %s (make VER=64).",
+	      (int64_t)PAIR_MAX, progname());
+    jp->max = 2*jp->max < PAIR_MAX ? 2*jp->max : PAIR_MAX;
+    jp->keys = (uint64_t *)erealloc(jp->keys,jp->max*sizeof(uint64_t));
+    jp->c = (CountInt *)erealloc(jp->c,(size_t)jp->max*jp->numDist*sizeof(CountInt));
+  }
+  id = jp->n++;
+  jp->keys[id] = key;
+  for(i=0;i<jp->numDist;i++)
+    jp->c[(size_t)id*jp->numDist+i] = 0;
+  jp->slots[h] = id;
+  if(2*jp->n > jp->numSlots)
+    rehashPairs(jp);
+  if(jointMemLimit && jointMem(jp) > jointMemLimit)
+    eprintf("the counts of %d distances need more than the memory limit of %lu MB; please count fewer distances together.",
+	    jp->numDist, (unsigned long)(jointMemLimit >> 20));
+  return id;
+}
+
+/* rehashPairs: double the number of slots and reinsert the pairs */
+void rehashPairs(JointPairs *jp){
+  size_t h, i;
+
+  jp->numSlots = jp->numSlots ? 2*jp->numSlots : 2048;
+  jp->slots = (PairInt *)erealloc(jp->slots,jp->numSlots*sizeof(PairInt));
+  for(i=0;i<jp->numSlots;i++)
+    jp->slots[i] = -1;
+  for(i=0;i<jp->n;i++){
+    h = hashPair(jp->keys[i]) & (jp->numSlots-1);
+    while(jp->slots[h] != -1)
+      h = (h+1) & (jp->numSlots-1);
+    jp->slots[h] = i;
+  }
+}
+
+/* hashPair: multiplicative hash of the two profile indexes */
+uint64_t hashPair(uint64_t key){
+  return ((uint64_t)(unsigned int)KEY_A(key) * 2654435761u) ^ ((uint64_t)(unsigned int)KEY_B(key) * 40503u);
+}
+
+/* finishJointPairs: list the non-zero counts by distance, drop 
+ * the hash, and compute the products of site likelihoods, which
+ * must be known 
+ */
+void finishJointPairs(JointPairs *jp){
+  double *lOnes, *lTwos, *lScales;
+  size_t i, m;
+  int a, b, k;
+
+  jp->colStart = (size_t *)emalloc((jp->numDist+1)*sizeof(size_t));
+  jp->numPos = (double *)emalloc(jp->numDist*sizeof(double));
+  m = 0;
+  for(k=0;k<jp->numDist;k++)
+    for(i=0;i<jp->n;i++)
+      if(jp->c[(size_t)i*jp->numDist+k])
+	m++;
+  jp->id = (PairInt *)emalloc((m+1)*sizeof(PairInt));
+  jp->cnt = (CountInt *)emalloc((m+1)*sizeof(CountInt));
+  m = 0;
+  for(k=0;k<jp->numDist;k++){
+    jp->colStart[k] = m;
+    jp->numPos[k] = 0.;
+    for(i=0;i<jp->n;i++)
+      if(jp->c[(size_t)i*jp->numDist+k]){
+	jp->id[m] = i;
+	jp->cnt[m] = jp->c[(size_t)i*jp->numDist+k];
+	jp->numPos[k] += jp->cnt[m++];
+      }
+  }
+  jp->colStart[jp->numDist] = m;
+  free(jp->c);
+  jp->c = NULL;
+  free(jp->slots);
+  jp->slots = NULL;
+  lOnes = getLones();
+  lTwos = getLtwos();
+  lScales = getLscales();
+  jp->p11 = (double *)emalloc((jp->n+1)*sizeof(double));
+  jp->p22 = (double *)emalloc((jp->n+1)*sizeof(double));
+  jp->p12 = (double *)emalloc((jp->n+1)*sizeof(double));
+  jp->s = (double *)emalloc((jp->n+1)*sizeof(double));
+  for(i=0;i<jp->n;i++){
+    a = KEY_A(jp->keys[i]);
+    b = KEY_B(jp->keys[i]);
+    jp->p11[i] = lOnes[a]*lOnes[b];
+    jp->p22[i] = lTwos[a]*lTwos[b];
+    jp->p12[i] = lOnes[a]*lTwos[b]+lTwos[a]*lOnes[b];
+    jp->s[i] = lScales[a] + lScales[b];
+  }
+}
+
+/* jointLik: add the log-likelihoods of the pairs at the numCol 
+ * distances from first+col*step on under k sets of pair 
+ * probabilities to l[0],...,l[k-1]; the sum runs in parallel 
+ * through reduceSum
+ */
+void jointLik(JointPairs *jp, int col, int numCol, double *h0, double *h2, double *complementHalf, int k, double *l){
+  JointLikData d;
+
+  d.jp = jp;
+  d.first = jp->colStart[col];
+  d.h0 = h0;
+  d.h2 = h2;
+  d.complementHalf = complementHalf;
+  d.k = k;
+  reduceSum(jp->colStart[col+numCol] - d.first, k, jointLikRange, &d, l);
+}
+
+KERNEL void jointLikRange(size_t lo, size_t hi, void *data, double *l){
+  JointLikData *d;
+  JointPairs *jp;
+  size_t i, m;
+  int j;
+  double li;
+
+  d = (JointLikData *)data;
+  jp = d->jp;
+  for(m=d->first+lo;m<d->first+hi;m++){
+    i = jp->id[m];
+    for(j=0;j<d->k;j++){
+      li = d->h0[j]*jp->p11[i] + d->h2[j]*jp->p22[i] + d->complementHalf[j]*jp->p12[i];
+      if(li>0)
+	l[j] += (log(li) + jp->s[i]) * jp->cnt[m];
+      else
+	l[j] += (log(DBL_MIN) + jp->s[i]) * jp->cnt[m];
+    }
+  }
+}
+
+/* jointLikCols: add the log-likelihood of the pairs at all 
+ * distances to l, where the pairs at distance first+k*step have 
+ * probabilities h0[k], h2[k], and complementHalf[k]; the sum over 
+ * all distances runs in parallel through reduceSum
+ */
+void jointLikCols(JointPairs *jp, double *h0, double *h2, double *complementHalf, double *l){
+  JointLikData d;
+
+  d.jp = jp;
+  d.first = 0;
+  d.h0 = h0;
+  d.h2 = h2;
+  d.complementHalf = complementHalf;
+  d.k = 1;
+  reduceSum(jp->colStart[jp->numDist], 1, jointLikColsRange, &d, l);
+}
+
+KERNEL void jointLikColsRange(size_t lo, size_t hi, void *data, double *l){
+  JointLikData *d;
+  JointPairs *jp;
+  size_t i, m;
+  int k, a, b;
+  double li;
+
+  d = (JointLikData *)data;
+  jp = d->jp;
+  /* distance of entry lo */
+  a = 0;
+  b = jp->numDist;
+  while(a < b){
+    k = (a + b) / 2;
+    if(jp->colStart[k+1] <= lo)
+      a = k + 1;
+    else
+      b = k;
+  }
+  k = a;
+  for(m=lo;m<hi;m++){
+    while(m >= jp->colStart[k+1])
+      k++;
+    i = jp->id[m];
+    li = d->h0[k]*jp->p11[i] + d->h2[k]*jp->p22[i] + d->complementHalf[k]*jp->p12[i];
+    if(li>0)
+      l[0] += (log(li) + jp->s[i]) * jp->cnt[m];
+    else
+      l[0] += (log(DBL_MIN) + jp->s[i]) * jp->cnt[m];
+  }
+}
+
+void freeJointPairs(JointPairs *jp){
+  if(jp){
+    free(jp->keys);
+    free(jp->slots);
+    free(jp->c);
+    free(jp->colStart);
+    free(jp->id);
+    free(jp->cnt);
+    free(jp->p11);
+    free(jp->p22);
+    free(jp->p12);
+    free(jp->s);
+    free(jp->numPos);
+    free(jp);
+  }
+}
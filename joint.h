@@ -0,0 +1,40 @@
+/***** joint.h ************************************
+ * Description: Header file for joint.c.
+ * License: GNU General Public
+ **************************************************/
+#ifndef JOINT
+#define JOINT
+#include <stdio.h>
+#include <stdint.h>
+#include "interface.h"
+#include "ld.h"
+
+typedef struct jointPairs{ /* pair counts of a block of distances: */
+  size_t n;                /* number of distinct pairs */
+  size_t max;              /* number of pairs allocated */
+  int first;               /* first distance */
+  int step;                /* step between distances */
+  int numDist;             /* number of distances */
+  uint64_t *keys;          /* distinct pairs */
+  PairInt *slots;          /* hash slots holding pair index or -1 */
+  size_t numSlots;         /* number of slots, a power of two */
+  CountInt *c;             /* counts, numDist per pair while counting */
+  size_t *colStart;        /* non-zero counts of distance k are colStart[k],...,colStart[k+1]-1 */
+  PairInt *id;             /* pair of each non-zero count */
+  CountInt *cnt;           /* non-zero counts */
+  double *p11;             /* lOnes[a]*lOnes[b] */
+  double *p22;             /* lTwos[a]*lTwos[b] */
+  double *p12;             /* lOnes[a]*lTwos[b]+lTwos[a]*lOnes[b] */
+  double *s;               /* lScales[a]+lScales[b] */
+  double *numPos;          /* number of pairs of each distance */
+}JointPairs;
+
+void setJointMemLimit(size_t limit);
+JointPairs *countJointPairs(ContigDescr *contigDescr, FILE *fp, int first, int step, int numDist);
+JointPairs *newJointPairs(int first, int step, int numDist);
+void addJointPair(JointPairs *jp, uint64_t key, int k);
+void finishJointPairs(JointPairs *jp);
+void jointLik(JointPairs *jp, int col, int numCol, double *h0, double *h2, double *complementHalf, int k, double *l);
+void jointLikCols(JointPairs *jp, double *h0, double *h2, double *complementHalf, double *l);
+void freeJointPairs(JointPairs *jp);
+#endif
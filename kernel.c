@@ -0,0 +1,24 @@
+/***** kernel.c ***********************************
+ * Description: Report the instruction set variant
+ *   of the kernels marked by KERNEL that runs on 
+ *   this processor.
+ * License: GNU General Public
+ **************************************************/
+#include <stdio.h>
+#include "kernel.h"
+
+/* kernelVariant: name of the kernel variant selected for this 
+ * processor; this follows the priority gcc applies to the clones
+ */
+char *kernelVariant(){
+#if defined(__GNUC__) && __GNUC__ >= 6 && defined(__x86_64__) && !defined(NO_CLONES)
+  __builtin_cpu_init();
+  if(__builtin_cpu_supports("avx512f"))
+    return "avx512f";
+  if(__builtin_cpu_supports("avx2"))
+    return "avx2";
+  return "sse2";
+#else
+  return "generic";
+#endif
+}
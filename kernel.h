@@ -0,0 +1,19 @@
+/***** kernel.h ***********************************
+ * Description: Header file for kernel.c.
+ * License: GNU General Public
+ **************************************************/
+#ifndef KERNEL_H
+#define KERNEL_H
+
+/* KERNEL marks the hot loops, which gcc compiles once per 
+ * instruction set listed; the variant is chosen when the program
+ * is loaded. Build with -DNO_CLONES for a single variant. 
+ */
+#if defined(__GNUC__) && __GNUC__ >= 6 && defined(__x86_64__) && !defined(NO_CLONES)
+#define KERNEL __attribute__((target_clones("default","avx2","avx512f")))
+#else
+#define KERNEL
+#endif
+
+char *kernelVariant();
+#endif
@@ -19,53 +19,213 @@ void setContigDescr(ContigDescr *contigDescr){
 
 
 FILE *iniLdAna(Args *args){
-  char *fileName;
-  char *tag;
   FILE *fp;
   ContigDescr *cp;
-  int i, max, n, numRead;
+  int i, max;
 
   /* get contig lengths from file */
-  tag = (char *)emalloc(4*sizeof(char));
-  fileName = (char *)emalloc(256*sizeof(char));
-  fileName = strcpy(fileName,args->n);
-  fileName = strcat(fileName,".con");
-  fp = efopen(fileName,"rb");
-  numRead = fread(tag,sizeof(char),3,fp);
-  assert(numRead == 3);
-  tag[3] = '\0';
-  if(strcmp(tag,"con") != 0)
-    assert(0);
   cp = (ContigDescr *)emalloc(sizeof(ContigDescr));
-  numRead = fread(&n,sizeof(int),1,fp);
-  assert(numRead == 1);
-  cp->n = n;
-  cp->len = (int *)emalloc(n*sizeof(int));
-  for(i=0;i<cp->n;i++){
-    numRead = fread(&cp->len[i],sizeof(int),1,fp);
-    assert(numRead == 1);
-  }
-  fclose(fp);
+  cp->len = readContigLengths(args->n, &cp->n);
   max = 0;
-  for(i=0;i<n;i++){
+  for(i=0;i<cp->n;i++){
     if(cp->len[i] > max)
       max = cp->len[i];
   }
   cp->posBuf = (Position *)emalloc(max*sizeof(Position));
+  cp->nextBuf = (Position *)emalloc(max*sizeof(Position));
   setContigDescr(cp);
 
   /* get file pointer for position file */
-  fileName = strcpy(fileName,args->n);
-  fileName = strcat(fileName,".pos");
+  fp = openPos(args->n, "rb", &cp->wide);
+  return fp;
+}
+
+/* readContigLengths: read the n contig lengths in baseName.con */
+int *readContigLengths(char *baseName, int *n){
+  char *fileName;
+  char tag[4];
+  FILE *fp;
+  int *len;
+  int numRead;
+
+  fileName = (char *)emalloc(256*sizeof(char));
+  fileName = strcpy(fileName,baseName);
+  fileName = strcat(fileName,".con");
   fp = efopen(fileName,"rb");
   numRead = fread(tag,sizeof(char),3,fp);
-  if(strcmp(tag,"pos") != 0)
+  assert(numRead == 3);
+  tag[3] = '\0';
+  if(strcmp(tag,"con") != 0)
     assert(0);
+  numRead = fread(n,sizeof(int),1,fp);
+  assert(numRead == 1);
+  len = (int *)emalloc((*n+1)*sizeof(int));
+  numRead = fread(len,sizeof(int),*n,fp);
+  assert(numRead == *n);
+  fclose(fp);
+  free(fileName);
+
+  return len;
+}
+
+/* writeContigLengths: write the n contig lengths to baseName.con */
+void writeContigLengths(char *baseName, int *len, int n){
+  char *fileName;
+  FILE *fp;
+  int numWritten;
+
+  fileName = (char *)emalloc(256*sizeof(char));
+  fileName = strcpy(fileName,baseName);
+  fileName = strcat(fileName,".con");
+  fp = efopen(fileName,"wb");
+  numWritten = fwrite("con",sizeof(char),3,fp);
+  assert(numWritten == 3);
+  numWritten = fwrite(&n,sizeof(int),1,fp);
+  assert(numWritten == 1);
+  numWritten = fwrite(len,sizeof(int),n,fp);
+  assert(numWritten == n);
+  fclose(fp);
+  free(fileName);
+}
+
+/* openPos: open baseName.pos; when reading or appending, get the
+ * format from the tag, when writing a new file, write the tag of 
+ * format *wide 
+ */
+FILE *openPos(char *baseName, char *mode, int *wide){
+  char *fileName;
+  char tag[4];
+  FILE *fp;
+  int n;
+
+  fileName = (char *)emalloc(256*sizeof(char));
+  fileName = strcpy(fileName,baseName);
+  fileName = strcat(fileName,".pos");
+  if(mode[0] == 'w'){
+    fp = efopen(fileName,mode);
+    n = fwrite(*wide ? "p64" : "pos",sizeof(char),3,fp);
+    assert(n == 3);
+  }else{
+    fp = efopen(fileName,"rb");
+    n = fread(tag,sizeof(char),3,fp);
+    tag[3] = '\0';
+    if(n == 3 && strcmp(tag,"pos") == 0)
+      *wide = 0;
+    else if(n == 3 && strcmp(tag,"p64") == 0){
+#ifndef VER64
+      eprintf("%s is in the 64-bit format; please use a 64-bit build of %s (make VER=64).",fileName,progname());
+#endif
+      *wide = 1;
+    }else
+      eprintf("%s is not a position file.",fileName);
+    if(mode[0] == 'a'){
+      fclose(fp);
+      fp = efopen(fileName,mode);
+    }
+  }
   free(fileName);
-  free(tag);
   return fp;
 }
 
+/* readPositions: read up to max positions stored in the 32-bit
+ * (wide=0) or 64-bit format; return the number read 
+ */
+int readPositions(FILE *fp, Position *pb, int max, int wide){
+#ifdef VER64
+  Position32 p;
+  Position64 q;
+  int i, n;
+
+  if(!wide){
+    /* read the compact records into the front of pb and widen
+     * them from the back */
+    n = fread(pb,sizeof(Position32),max,fp);
+    for(i=n-1;i>=0;i--){
+      p = ((Position32 *)pb)[i];
+      pb[i].pos = p.pos;
+      pb[i].pro = p.pro;
+    }
+    return n;
+  }
+  /* the records have the size of a Position; convert them in place */
+  assert(sizeof(Position64) == sizeof(Position));
+  n = fread(pb,sizeof(Position64),max,fp);
+  for(i=0;i<n;i++){
+    memcpy(&q,(char *)pb+i*sizeof(Position64),sizeof(Position64));
+    pb[i].pos = q.pos;
+    pb[i].pro = q.pro;
+  }
+  return n;
+#else
+  return fread(pb,sizeof(Position),max,fp);
+#endif
+}
+
+void readContig(FILE *fp, Position *pb, int len, int wide){
+  int n;
+
+  n = readPositions(fp, pb, len, wide);
+  assert(n == len);
+}
+
+/* writePositions: write n positions in the 32-bit (wide=0) or 
+ * 64-bit format 
+ */
+void writePositions(FILE *fp, Position *pb, int n, int wide){
+#ifdef VER64
+  Position32 buf[POS_CHUNK];
+  Position64 wbuf[POS_CHUNK];
+  int i, m;
+#endif
+  int numWritten;
+
+#ifdef VER64
+  if(!wide){
+    while(n > 0){
+      m = n < POS_CHUNK ? n : POS_CHUNK;
+      for(i=0;i<m;i++){
+	if(pb[i].pos > INT32_MAX || pb[i].pos < INT32_MIN)
+	  eprintf("position " POS_FMT " does not fit into the 32-bit database format.",pb[i].pos);
+	buf[i].pos = pb[i].pos;
+	buf[i].pro = pb[i].pro;
+      }
+      numWritten = fwrite(buf,sizeof(Position32),m,fp);
+      assert(numWritten == m);
+      pb += m;
+      n -= m;
+    }
+    return;
+  }
+  while(n > 0){
+    m = n < POS_CHUNK ? n : POS_CHUNK;
+    for(i=0;i<m;i++){
+      wbuf[i].pos = pb[i].pos;
+      wbuf[i].pro = pb[i].pro;
+      wbuf[i].unused = 0;
+    }
+    numWritten = fwrite(wbuf,sizeof(Position64),m,fp);
+    assert(numWritten == m);
+    pb += m;
+    n -= m;
+  }
+  return;
+#endif
+  numWritten = fwrite(pb,sizeof(Position),n,fp);
+  assert(numWritten == n);
+}
+
+/* runEnd: end of the run of consecutive positions starting at 
+ * site s; within a run, the partner of site l at distance d is 
+ * site l+d 
+ */
+int runEnd(Position *pb, int len, int s){
+  int e;
+
+  for(e=s+1;e<len && pb[e].pos - pb[e-1].pos == 1;e++)
+    ;
+  return e;
+}
+
 ContigDescr *getContigDescr(){
   return thisContigDescr;
 }
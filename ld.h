@@ -5,19 +5,42 @@
  **************************************************/
 #ifndef LDHEADER
 #define LDHEADER
+#include <stdio.h>
+#include "types.h"
 
 typedef struct position{
-  int pos;
+  PosInt pos;
   int pro;
 }Position;
 
+typedef struct position32{ /* position in the 32-bit format */
+  int32_t pos;
+  int32_t pro;
+}Position32;
+
+typedef struct position64{ /* position in the 64-bit format */
+  int64_t pos;
+  int32_t pro;
+  int32_t unused;          /* zero */
+}Position64;
+
+#define POS_CHUNK 4096 /* positions converted at a time */
+
 typedef struct contigDescr{
   int n;                 /* number of contigs */
-  int *len;              /* contig lengths */
+  int *len;              /* contig lengths, at most INT_MAX sites each */
   Position *posBuf;      /* buffer of positions */
+  Position *nextBuf;     /* second buffer, filled by the contig reader */
+  int wide;              /* positions are stored in the 64-bit format */
 }ContigDescr;
 
 ContigDescr *getContigDescr();
 FILE *iniLdAna(Args *args);
-ContigDescr *getContigDescr();
+int *readContigLengths(char *baseName, int *n);
+void writeContigLengths(char *baseName, int *len, int n);
+FILE *openPos(char *baseName, char *mode, int *wide);
+int readPositions(FILE *fp, Position *pb, int max, int wide);
+void readContig(FILE *fp, Position *pb, int len, int wide);
+void writePositions(FILE *fp, Position *pb, int n, int wide);
+int runEnd(Position *pb, int len, int s);
 #endif
@@ -4,14 +4,20 @@
  * Date: Thu Feb 19 09:56:43 2009
  **************************************************/
 #include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <float.h>
 #include <assert.h>
+#include <gsl/gsl_errno.h>
 #include "eprintf.h"
 #include "interface.h"
 #include "profile.h"
 #include "profileTree.h"
 #include "mlComp.h"
+#include "kernel.h"
 
 double *freqNuc;
+double logFreqNuc[4];
 double totalNuc;
 double S, logS;
 double likelihood;
@@ -19,17 +25,28 @@ double lo2;
 double *lngamma;
 gsl_sf_result *result;
 int maxCov;
-int *coverages;
+PackedProfiles *packed = NULL;
+/* fast path of likP, profiles in coverage order */
+int fastN;
+int *covOrder = NULL;
+uint16_t *fastCount[4];
+int *fastCov;
+float *fastMult;
+float *fastNum;
+double fastCheckedEe = 0.; /* ee of the last check of the fast path */
 
 void compS();
-inline double powInt(double x, int y);
+int cmpCov(const void *p1, const void *p2);
 
 int *getCoverages(){
-  return coverages;
+  return packed ? packed->cov : NULL;
 }
 
-void iniMlComp(Profile *profiles, int numProfile){
-  int i, j;
+/* iniMlComp: set up the likelihood computation on the profiles in 
+ * pp, which remain owned by the caller 
+ */
+void iniMlComp(PackedProfiles *pp, int numProfile){
+  int i, j, p[4];
 
   freqNuc = (double *)emalloc(4*sizeof(double));
   result = (gsl_sf_result *)emalloc(sizeof(gsl_sf_result));
@@ -37,76 +54,232 @@ void iniMlComp(Profile *profiles, int numProfile){
     freqNuc[i] = 0.0;
   totalNuc = 0;
   maxCov = 0;
-  coverages = (int *)emalloc(numProfile*sizeof(int));
+  packed = pp;
   for(i=0;i<numProfile;i++){
-    coverages[i] = 0;
-    for(j=0;j<4;j++){
-      freqNuc[j] += (profiles[i].profile[j] * profiles[i].n);
-      coverages[i] += profiles[i].profile[j];
-    }
-    if(maxCov < coverages[i])
-      maxCov = coverages[i];
+    unpackProfile(packed, i, p);
+    for(j=0;j<4;j++)
+      freqNuc[j] += (p[j] * packed->num[i]);
+    if(maxCov < packed->cov[i])
+      maxCov = packed->cov[i];
   }
   lngamma = (double *)emalloc((maxCov+2)*sizeof(double));
   for(i=1;i<=maxCov+1;i++)
     lngamma[i] = gsl_sf_lngamma(i);
   for(i=0;i<4;i++)
     totalNuc += freqNuc[i];
-  for(i=0;i<4;i++)
+  for(i=0;i<4;i++){
     freqNuc[i] /= totalNuc;
-  
+    logFreqNuc[i] = log(freqNuc[i]);
+  }
+
   compS();
 }
 
-/* lOne: equation (4a) of Lynch (2008) as revised by Stephen Bates on June 24, 2012 */
-inline double lOne(int cov, int *profile, double ee){
-  int i;
-  double s, compEe, eeThird, g;
+/* logLOne: logarithm of equation (4a) of Lynch (2008) as revised 
+ * by Stephen Bates on June 24, 2012, for allele counts c0,...,c3;
+ * the sum is computed by log-sum-exp, which does not underflow at 
+ * high coverage
+ */
+KERNEL double logLOne(int cov, int c0, int c1, int c2, int c3, double ee){
+  double t[4], logCompEe, logEeThird, g;
 
-  s = 0.0;
-  compEe = 1.0 - ee;
-  eeThird = ee / 3.0;
-  g = 0.0;
-  for(i=0;i<4;i++){
-    s += freqNuc[i] * powInt(compEe, profile[i]) * powInt(eeThird,cov-profile[i]);
-    g += lngamma[profile[i]+1];
-  }
-  g = exp(lngamma[cov+1]-g);
-  s *= g;
-  return s;
+  logCompEe = log(1.0 - ee);
+  logEeThird = log(ee / 3.0);
+  g = lngamma[cov+1] - lngamma[c0+1] - lngamma[c1+1] - lngamma[c2+1] - lngamma[c3+1];
+  t[0] = logFreqNuc[0] + xLogY(c0, logCompEe) + xLogY(cov-c0, logEeThird);
+  t[1] = logFreqNuc[1] + xLogY(c1, logCompEe) + xLogY(cov-c1, logEeThird);
+  t[2] = logFreqNuc[2] + xLogY(c2, logCompEe) + xLogY(cov-c2, logEeThird);
+  t[3] = logFreqNuc[3] + xLogY(c3, logCompEe) + xLogY(cov-c3, logEeThird);
+  return g + logSumExp(t, 4);
 }
 
-/* lTwo: equation (4b) of Lynch (2008) as revised by Stephen Bates on June 24, 2012 */
-inline double lTwo(int cov, int *profile, double ee){
-  int i, j;
-  double s, g, x, eeThird;
+/* logLTwo: logarithm of equation (4b) of Lynch (2008) as revised 
+ * by Stephen Bates on June 24, 2012, for allele counts c0,...,c3,
+ * computed by log-sum-exp 
+ */
+KERNEL double logLTwo(int cov, int c0, int c1, int c2, int c3, double ee){
+  double t[6], g, logX, logEeThird;
 
   /* compute multinomial coefficient */
-  g = 0.0;
-  for(i=0;i<4;i++)
-    g += lngamma[profile[i]+1];
-  g = exp(lngamma[cov+1]-g);
+  g = lngamma[cov+1] - lngamma[c0+1] - lngamma[c1+1] - lngamma[c2+1] - lngamma[c3+1];
   /* compute likelihood */
+  logEeThird = log(ee/3.0);
+  logX = log((1.0-2.0*ee/3.0)/2.0);
+  t[0] = logFreqNuc[0] + logFreqNuc[1] - logS + xLogY(c0+c1, logX) + xLogY(cov-c0-c1, logEeThird);
+  t[1] = logFreqNuc[0] + logFreqNuc[2] - logS + xLogY(c0+c2, logX) + xLogY(cov-c0-c2, logEeThird);
+  t[2] = logFreqNuc[0] + logFreqNuc[3] - logS + xLogY(c0+c3, logX) + xLogY(cov-c0-c3, logEeThird);
+  t[3] = logFreqNuc[1] + logFreqNuc[2] - logS + xLogY(c1+c2, logX) + xLogY(cov-c1-c2, logEeThird);
+  t[4] = logFreqNuc[1] + logFreqNuc[3] - logS + xLogY(c1+c3, logX) + xLogY(cov-c1-c3, logEeThird);
+  t[5] = logFreqNuc[2] + logFreqNuc[3] - logS + xLogY(c2+c3, logX) + xLogY(cov-c2-c3, logEeThird);
+  return g + logSumExp(t, 6);
+}
+
+/* logSumExp: log(exp(x[0]) + ... + exp(x[n-1])) */
+double logSumExp(double *x, int n){
+  int i;
+  double m, s;
+
+  m = -INFINITY;
+  for(i=0;i<n;i++)
+    if(x[i] > m)
+      m = x[i];
+  if(m == -INFINITY)
+    return m;
   s = 0.0;
-  eeThird = ee/3.0;
-  x = (1.0-2.0*eeThird)/2.0;
-  for(i=0;i<4;i++)
-    for(j=i+1;j<4;j++){
-      s += freqNuc[i]*freqNuc[j]/S * powInt(x,profile[i]+profile[j]) * powInt(eeThird,cov-profile[i]-profile[j]);
+  for(i=0;i<n;i++)
+    s += exp(x[i] - m);
+  return m + log(s);
+}
+
+/* xLogY: n*logY with 0*log(0) = 0 */
+double xLogY(int n, double logY){
+  return n ? n * logY : 0.0;
+}
+
+/* iniFastLik: order profiles by coverage and precompute the 
+ * ee-independent parts of equations (4a) and (4b) in single 
+ * precision for the fast path of likP 
+ */
+void iniFastLik(PackedProfiles *pp, int numProfile){
+  int i, j, k, p[4];
+
+  fastN = numProfile;
+  covOrder = (int *)emalloc(numProfile*sizeof(int));
+  for(i=0;i<numProfile;i++)
+    covOrder[i] = i;
+  qsort(covOrder,numProfile,sizeof(int),cmpCov);
+  for(j=0;j<4;j++)
+    fastCount[j] = (uint16_t *)emalloc(numProfile*sizeof(uint16_t));
+  fastCov = (int *)emalloc(numProfile*sizeof(int));
+  fastMult = (float *)emalloc(numProfile*sizeof(float));
+  fastNum = (float *)emalloc(numProfile*sizeof(float));
+  for(k=0;k<numProfile;k++){
+    i = covOrder[k];
+    fastCov[k] = pp->cov[i];
+    fastMult[k] = lngamma[pp->cov[i]+1];
+    unpackProfile(pp, i, p);
+    for(j=0;j<4;j++){
+      fastCount[j][k] = pp->count[j][i];
+      fastMult[k] -= lngamma[p[j]+1];
     }
-  s *= g;
-  return s;
+    fastMult[k] = expf(fastMult[k]);
+    fastNum[k] = pp->num[i];
+  }
 }
 
-inline double powInt(double x, int y){
-  int i;
-  double p;
+/* numFastProfiles: number of profiles, in coverage order, whose 
+ * likelihood terms stay within single precision range given ee 
+ */
+int numFastProfiles(double ee){
+  int lo, hi, mid, maxCovFast;
+  double r;
+
+  if(covOrder == NULL || ee <= 0 || ee >= 0.75)
+    return 0;
+  r = -log(FLT_MIN) - FAST_MARGIN;
+  if(-log(ee/3.0) * MAX_FAST_COV > r)
+    maxCovFast = (int)(r / -log(ee/3.0));
+  else
+    maxCovFast = MAX_FAST_COV;
+  lo = 0;
+  hi = fastN;
+  while(lo < hi){
+    mid = (lo + hi) / 2;
+    if(fastCov[mid] <= maxCovFast)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo;
+}
 
-  p = 1.;
-  for(i=0;i<y;i++)
-    p *= x;
+/* likPFast: log-likelihood of profiles lo,...,hi-1 in coverage
+ * order; equations (4a) and (4b) are evaluated directly in 
+ * single precision from tables of powers
+ */
+KERNEL double likPFast(int lo, int hi, double pi, double ee){
+  float a[MAX_FAST_COV+1], e[MAX_FAST_COV+1], x[MAX_FAST_COV+1];
+  float f[4], ff[6];
+  float l1, l2, fPi, fCompPi;
+  double l;
+  int i, j, k, c;
+  uint16_t *c0, *c1, *c2, *c3;
 
-  return p;
+  a[0] = e[0] = x[0] = 1.0f;
+  for(i=1;i<=MAX_FAST_COV;i++){
+    a[i] = a[i-1] * (float)(1.0 - ee);
+    e[i] = e[i-1] * (float)(ee/3.0);
+    x[i] = x[i-1] * (float)((1.0-2.0*ee/3.0)/2.0);
+  }
+  k = 0;
+  for(i=0;i<4;i++){
+    f[i] = freqNuc[i];
+    for(j=i+1;j<4;j++)
+      ff[k++] = freqNuc[i]*freqNuc[j]/S;
+  }
+  fPi = pi;
+  fCompPi = 1.0 - pi;
+  c0 = fastCount[0];
+  c1 = fastCount[1];
+  c2 = fastCount[2];
+  c3 = fastCount[3];
+  l = 0.;
+  for(i=lo;i<hi;i++){
+    c = fastCov[i];
+    l1 = f[0]*a[c0[i]]*e[c-c0[i]] + f[1]*a[c1[i]]*e[c-c1[i]] 
+      + f[2]*a[c2[i]]*e[c-c2[i]] + f[3]*a[c3[i]]*e[c-c3[i]];
+    l2 = ff[0]*x[c0[i]+c1[i]]*e[c-c0[i]-c1[i]] + ff[1]*x[c0[i]+c2[i]]*e[c-c0[i]-c2[i]]
+      + ff[2]*x[c0[i]+c3[i]]*e[c-c0[i]-c3[i]] + ff[3]*x[c1[i]+c2[i]]*e[c-c1[i]-c2[i]]
+      + ff[4]*x[c1[i]+c3[i]]*e[c-c1[i]-c3[i]] + ff[5]*x[c2[i]+c3[i]]*e[c-c2[i]-c3[i]];
+    l += logf(fastMult[i] * (l1*fCompPi + l2*fPi)) * fastNum[i];
+  }
+  return l;
+}
+
+/* checkFastLik: compare the fast path of likP to the log-sum-exp
+ * path on the profiles it covers; return 1 if they agree 
+ */
+int checkFastLik(double pi, double ee){
+  double fast, exact, t[2];
+  int i, n;
+  uint16_t *c0, *c1, *c2, *c3;
+
+  fastCheckedEe = ee;
+  n = numFastProfiles(ee);
+  if(n == 0)
+    return 1;
+  fast = likPFast(0, n, pi, ee);
+  exact = 0.;
+  c0 = fastCount[0];
+  c1 = fastCount[1];
+  c2 = fastCount[2];
+  c3 = fastCount[3];
+  for(i=0;i<n;i++){
+    t[0] = log(1.0-pi) + logLOne(fastCov[i], c0[i], c1[i], c2[i], c3[i], ee);
+    t[1] = log(pi) + logLTwo(fastCov[i], c0[i], c1[i], c2[i], c3[i], ee);
+    exact += logSumExp(t, 2) * fastNum[i];
+  }
+  return fabs(fast - exact) <= FAST_TOLERANCE * fabs(exact);
+}
+
+/* fastLikValid: check the fast path again at pi and ee if ee lies
+ * more than a factor FAST_RECHECK from the last value checked; 
+ * return 1 if it may be used 
+ */
+int fastLikValid(double pi, double ee){
+  if(ee <= 0 || fastCheckedEe <= 0)
+    return checkFastLik(pi, ee);
+  if(ee < fastCheckedEe * FAST_RECHECK && ee > fastCheckedEe / FAST_RECHECK)
+    return 1;
+  return checkFastLik(pi, ee);
+}
+
+int *getCovOrder(){
+  return covOrder;
+}
+
+int cmpCov(const void *p1, const void *p2){
+  return packed->cov[*(int *)p1] - packed->cov[*(int *)p2];
 }
 
 /* compS: compute global variable S */
@@ -128,12 +301,97 @@ void setFreqNuc(double *f)
 
 void freeMlComp()
 {
-  /* int i; */
+  int i;
 
   free(freqNuc);
   free(result);
   free(lngamma);
-  free(coverages);
+  packed = NULL;
+  if(covOrder){
+    free(covOrder);
+    for(i=0;i<4;i++)
+      free(fastCount[i]);
+    free(fastCov);
+    free(fastMult);
+    free(fastNum);
+    covOrder = NULL;
+  }
+}
+
+/* minimizeOne: minimize a function of one parameter using the 
+ * Nelder-Mead Simplex algorithm as in estimateDelta, starting 
+ * at x0, and return the location of the minimum 
+ */
+double minimizeOne(double (*f)(const gsl_vector *v, void *params), void *params, double x0, Args *args){
+  const gsl_multimin_fminimizer_type *T;
+  gsl_multimin_fminimizer *s;
+  gsl_vector *ss, *x;
+  gsl_multimin_function minex_func;
+  size_t iter;
+  int status;
+  double size;
+
+  T =  gsl_multimin_fminimizer_nmsimplex;
+  iter = 0;
+  ss = gsl_vector_alloc(1);
+  gsl_vector_set_all(ss, args->s > 0 ? args->s : STEP_SIZE);
+  x = gsl_vector_alloc(1);
+  gsl_vector_set(x, 0, x0);
+  minex_func.f = f;
+  minex_func.n = 1;
+  minex_func.params = params;
+  s = gsl_multimin_fminimizer_alloc(T, 1);
+  gsl_multimin_fminimizer_set(s, &minex_func, x, ss);
+  do{
+    iter++;
+    status = gsl_multimin_fminimizer_iterate(s);
+    if(status)
+      break;
+    size = gsl_multimin_fminimizer_size(s);
+    status = gsl_multimin_test_size(size, args->t);
+  }while(status == GSL_CONTINUE && iter < args->i);
+  x0 = gsl_vector_get(s->x, 0);
+  gsl_vector_free(x);
+  gsl_vector_free(ss);
+  gsl_multimin_fminimizer_free(s);
+
+  return x0;
+}
+
+/* curvBounds: likelihood interval of a parameter with estimate 
+ * x0 from the curvature of the log-likelihood at x0; g(x) is the
+ * log-likelihood at x minus its maximum plus 2, as used by the root
+ * searches for the bounds. The quadratic fit is accepted only if 
+ * g is close to zero at both bounds and they lie within [min,max];
+ * return 1 if the bounds were set, 0 otherwise 
+ */
+int curvBounds(double (*g)(double x, void *params), void *params, double x0, 
+	       double min, double max, double *lo, double *up){
+  double h, g0, gp, gm, b, c, d, l, u;
+
+  h = CURV_STEP * fabs(x0);
+  if(h == 0.)
+    h = CURV_STEP;
+  if(x0 - h < min || x0 + h > max)
+    return 0;
+  g0 = g(x0, params);
+  gp = g(x0 + h, params);
+  gm = g(x0 - h, params);
+  /* g(x0+t) = g0 + b*t - c*t*t/2 */
+  b = (gp - gm) / (2. * h);
+  c = (2. * g0 - gp - gm) / (h * h);
+  d = b * b + 2. * c * g0;
+  if(c <= 0. || d < 0.)
+    return 0;
+  l = x0 + (b - sqrt(d)) / c;
+  u = x0 + (b + sqrt(d)) / c;
+  if(l < min || u > max)
+    return 0;
+  if(fabs(g(l, params)) > CURV_TOLERANCE || fabs(g(u, params)) > CURV_TOLERANCE)
+    return 0;
+  *lo = l;
+  *up = u;
+  return 1;
 }
 
 Result *newResult(){
@@ -13,6 +13,16 @@
 #include "profileTree.h"
 
 #define MAX_ITER 1000
+#define MAX_FAST_COV 60      /* maximum coverage in fast path of likP */
+#define FAST_MARGIN 20.      /* distance from FLT_MIN in fast path, log units */
+#define FAST_TOLERANCE 1e-5  /* relative tolerance of fast path */
+#define FAST_RECHECK 2.      /* fast path checked again if ee moves by this factor */
+#define CURV_STEP 1e-3       /* relative step of the curvature estimate */
+#define CURV_TOLERANCE 0.1   /* error of curvature bounds, log-likelihood units */
+#define LIK_TAG "mlRhoLk2"   /* tag of a record in a likelihood file */
+#define LIK_HASH_INI UINT64_C(14695981039346656037) /* FNV-1a offset basis */
+#define LIK_HASH_MUL UINT64_C(1099511628211) /* FNV-1a prime */
+#define LIK_WARM UINT64_C(0) /* parHash of a record kept only as a warm start */
 
 typedef struct result{
   double pi;   
@@ -33,16 +43,29 @@ typedef struct result{
   char type;   /* parameter type */
 }Result;
 
-Result *estimatePi(Profile *profiles, int numProfiles, Args *args, Result *result);
-Result *estimateDelta(Node **profilePairs, int numProfiles, Args *args, Result *result, int dist);
-double piComp_getNumPos(Profile *profiles, int numProfiles);
+Result *estimatePi(PackedProfiles *pp, int numProfiles, Args *args, Result *result);
+Result *estimateDelta(ProfilePairs *profilePairs, int numProfiles, Args *args, Result *result, double dist);
+double piComp_getNumPos(PackedProfiles *pp, int numProfiles);
 double deltaComp_getNumPos();
 /* void estimateDelta(Node *r, Args *args, Result *res, int np); */
 /* int estimateRho(Node *r, Args *args, Result *res, int np); */
-inline double lOne(int cov, int *profile, double ee);
-inline double lTwo(int cov, int *profile, double ee);
-void iniMlComp(Profile *profiles, int numProfile);
+double logLOne(int cov, int c0, int c1, int c2, int c3, double ee);
+double logLTwo(int cov, int c0, int c1, int c2, int c3, double ee);
+double logSumExp(double *x, int n);
+double xLogY(int n, double logY);
+void iniFastLik(PackedProfiles *pp, int numProfile);
+int numFastProfiles(double ee);
+double likPFast(int lo, int hi, double pi, double ee);
+int checkFastLik(double pi, double ee);
+int fastLikValid(double pi, double ee);
+int *getCovOrder();
+void iniMlComp(PackedProfiles *pp, int numProfile);
 void setPi(double pi);
+double rhoFromDelta(double t, double d);
+double deltaFromRho(double t, double r);
+void likDeltas(ProfilePairs *profilePairs, int numProfiles, double pi, double *de, int k, double *l);
+void writeLikSurface(FILE *fp, ProfilePairs *profilePairs, int numProfiles, Result *result, int dist);
+void compH(double pi, double de, double *h0, double *h2, double *complementHalf);
 void setEpsilon(double ee);
 void rhoSetPi(double pi);
 void rhoSetEpsilon(double ee);
@@ -52,9 +75,17 @@ void setMaxCov(int m);
 int *getCoverages();
 double *getLones();
 double *getLtwos();
+double *getLscales();
 
 inline double lOneDelta(int cov, int *profile, double ee);
 void writeLik(char *baseName, Result *result);
+uint64_t hashSum(char *baseName);
+void carryLik(char *baseName, uint64_t oldSum);
+int likMissed();
+void freeSiteLik();
+double minimizeOne(double (*f)(const gsl_vector *v, void *params), void *params, double x0, Args *args);
+int curvBounds(double (*g)(double x, void *params), void *params, double x0, 
+	       double min, double max, double *lo, double *up);
 Result *newResult();
 
 #endif
@@ -7,6 +7,7 @@
  **************************************************/
 #include <stdio.h>
 #include <stdlib.h>
+#include <limits.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <assert.h>
@@ -15,10 +16,22 @@
 #include "ld.h"
 #include "profile.h"
 #include "profileTree.h"
+#include "reader.h"
 #include "mlComp.h"
+#include "resample.h"
+#include "regional.h"
+#include "append.h"
+#include "reorder.h"
+#include "sample.h"
+#include "stream.h"
+#include "reduce.h"
+#include "trace.h"
+#include "bins.h"
+#include "rhoFit.h"
+#include "kernel.h"
 
 void runAnalysis(Args *args);
-void freeMem(Node **profilePairs, int numProfiles);
+void freeMem(ProfilePairs *profilePairs);
 
 int main(int argc, char *argv[]){
   Args *args;
@@ -31,7 +44,24 @@ int main(int argc, char *argv[]){
     printSplash(version);
   if(args->h || args->e)
     printUsage(version);
-  runAnalysis(args);
+  /* open the counters before any worker thread starts */
+  if(args->v)
+    openTrace(args->v, args->V);
+  iniReduce(args->c, args->u);
+  if(args->G > 0)
+    setJointMemLimit((size_t)args->G << 20);
+  if(args->a)
+    appendDb(args);
+  if(args->O)
+    reorderDb(args);
+  if(args->N)
+    runStream(args);
+  else if(args->x > 0.)
+    runSample(args);
+  else
+    runAnalysis(args);
+  freeReduce();
+  closeTrace();
   free(args);
   free(progname());
   return 0;
@@ -43,69 +73,113 @@ void runAnalysis(Args *args){
   int numProfiles;
   char *headerPi, *headerDeltaRho, *outStrPi, *outStrDeltaRho;
   double numPos;
-  Profile *profiles;
+  PackedProfiles *pp;
   ContigDescr *contigDescr;
-  FILE *fp;
-  Node **profilePairs;
+  FILE *fp, *sfp;
+  ProfilePairs *profilePairs;
+  char *mask;
 
   headerPi = "d\tn\ttheta\t\t\t\tepsilon\t\t\t\t-log(L)\n";
   headerDeltaRho = "d\tn\ttheta\t\t\t\tepsilon\t\t\t\t-log(L)\t\tdelta\t\t\t\trho\n";
   outStrPi = "%d\t%.0f\t%8.2e<%8.2e<%8.2e\t%8.2e<%8.2e<%8.2e\t%8.2e\n";
   outStrDeltaRho = "%d\t%.0f\t\t\t\t\t\t\t\t\t%8.2e\t%8.2e<%8.2e<%8.2e\t%8.2e<%8.2e<%8.2e\n";
+  printf("#Kernels: %s\n", kernelVariant());
   r = newResult();
   /* heterozygosity analysis */
+  traceBegin("readProfiles", -1);
   readProfiles(args->n);
+  traceEnd();
   numProfiles = getNumProfiles();
-  profiles = getProfiles();
+  pp = getPackedProfiles();
+  mask = NULL;
+  if(args->K > 0 || args->X < INT_MAX){
+    if(args->I)
+      eprintf("-I cannot be combined with -K or -X.");
+    mask = coverageMask(pp, args->K, args->X);
+    setMask(mask);
+  }
   if(args->M == 0 && numProfiles)
     printf("%s", headerPi);
   else
     printf("%s", headerDeltaRho);
   if(numProfiles){
-    r = estimatePi(profiles,numProfiles,args,r);
-    numPos = piComp_getNumPos(profiles, numProfiles);
+    traceBegin("estimatePi", -1);
+    r = estimatePi(pp,numProfiles,args,r);
+    traceEnd();
+    numPos = piComp_getNumPos(pp, numProfiles);
     printf(outStrPi,0,numPos,r->pLo,r->pi,r->pUp,r->eLo,r->ee,r->eUp,r->l);
+    if(likMissed())
+      writeLik(args->n,r);
   }
   fflush(NULL);
   /* linkage analysis */
+  traceBegin("iniLdAna", -1);
   fp = iniLdAna(args);
+  traceEnd();
   contigDescr = getContigDescr();
   profilePairs = NULL;
+  if(args->w || args->C){
+    runRegional(contigDescr, fp, args, r);
+    args->M = -1;  /* skip genome-wide analysis */
+  }else if(args->Q){
+    runRhoFit(contigDescr, fp, args, r);
+    args->M = -1;  /* skip the analysis by distance */
+  }else if(args->W){
+    runBins(contigDescr, fp, args, r);
+    args->M = -1;  /* skip the analysis by distance */
+  }
+  if(args->M > 0 && args->j)
+    printf("#Intervals of delta and rho from block-jackknife\n");
+  else if(args->M > 0 && args->b)
+    printf("#Intervals of delta and rho from %d block-bootstrap replicates\n",args->b);
+  sfp = NULL;
+  if(args->g && args->M > 0){
+    sfp = efopen(args->g,"w");
+    fprintf(sfp,"#d\tdelta\t-log(L)\n");
+  }
   for(i=args->m;i<=args->M;i+=args->S){
+    traceBegin("distance", i);
+    traceBegin("getProfilePairs", i);
     profilePairs = getProfilePairs(numProfiles, contigDescr, fp, args, i);
+    traceEnd();
+    traceBegin("estimateDelta", i);
     r = estimateDelta(profilePairs,numProfiles,args,r,i);
+    traceEnd();
+    if(sfp)
+      writeLikSurface(sfp, profilePairs, numProfiles, r, i);
+    if(args->b || args->j){
+      traceBegin("resampleDelta", i);
+      resampleDelta(contigDescr, fp, args, r, i);
+      traceEnd();
+    }
+    traceEnd();
     printf(outStrDeltaRho,i,getNumPos(),r->l,r->dLo,r->de,r->dUp,r->rLo,r->rh,r->rUp);
     fflush(NULL);
   }
   fclose(fp);
-  if(args->I)
-    writeLik(args->n,r);
+  if(sfp){
+    fclose(sfp);
+    printf("#Likelihood surfaces of delta written to %s\n",args->g);
+  }
+  setMask(NULL);
+  free(mask);
   free(r);
-  freeMem(profilePairs, numProfiles);
+  freeMem(profilePairs);
 }
 
-void freeMem(Node **profilePairs, int numProfiles){
-  int i;
-  double *lOnes, *lTwos;
-  Profile *profiles;
+void freeMem(ProfilePairs *profilePairs){
   ContigDescr *cd;
 
-  if(profilePairs){
-    for(i=0;i<numProfiles;i++)
-      freeTree(profilePairs[i]);
-    free(profilePairs);
-  }
+  freeProfilePairs(profilePairs);
   cd = getContigDescr();
   if(cd){
     free(cd->posBuf);
+    free(cd->nextBuf);
     free(cd->len);
     free(cd);
   }
-  lOnes = getLones();
-  lTwos = getLtwos();
-  profiles = getProfiles();
-  free(lOnes);
-  free(lTwos);
-  free(profiles);
+  freeSiteLik();
   freeMlComp();
+  freePackedProfiles(getPackedProfiles());
+  setPackedProfiles(NULL);
 }
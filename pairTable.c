@@ -0,0 +1,194 @@
+/***** pairTable.c ********************************
+ * Description: Flat table of profile pairs and 
+ *   their numbers of occurrence, an alternative to
+ *   the trees in profileTree.c that can be sliced
+ *   and reweighted.
+ * License: GNU General Public
+ **************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <float.h>
+#include <math.h>
+#include "eprintf.h"
+#include "interface.h"
+#include "ld.h"
+#include "pairTable.h"
+#include "reduce.h"
+#include "kernel.h"
+
+typedef struct pairLikData{ /* arguments of pairLikRange: */
+  PairTable *pt;
+  double *lOnes, *lTwos, *lScales;
+  double *h0, *h2, *complementHalf;
+  int k;
+}PairLikData;
+
+int cmpKey(const void *p1, const void *p2);
+void pairLikRange(size_t lo, size_t hi, void *data, double *l);
+
+PairTable *newPairTable(){
+  PairTable *pt;
+
+  pt = (PairTable *)emalloc(sizeof(PairTable));
+  pt->n = 0;
+  pt->max = 0;
+  pt->a = NULL;
+  pt->b = NULL;
+  pt->c = NULL;
+
+  return pt;
+}
+
+/* addPairKeys: sort n pair keys and append them to the
+ * table as distinct pairs with their counts; keys is 
+ * reordered in the process
+ */
+void addPairKeys(PairTable *pt, uint64_t *keys, int n){
+  int i, j;
+
+  if(n == 0)
+    return;
+  qsort(keys,n,sizeof(uint64_t),cmpKey);
+  for(i=0;i<n;i=j){
+    for(j=i+1;j<n && keys[j]==keys[i];j++)
+      ;
+    addPair(pt, KEY_A(keys[i]), KEY_B(keys[i]), j - i);
+  }
+}
+
+/* addPair: append pair a,b with c occurrences */
+void addPair(PairTable *pt, int a, int b, CountInt c){
+  if(pt->n == pt->max){
+    pt->max = pt->max ? 2*pt->max : 1024;
+    pt->a = (int *)erealloc(pt->a,pt->max*sizeof(int));
+    pt->b = (int *)erealloc(pt->b,pt->max*sizeof(int));
+    pt->c = (CountInt *)erealloc(pt->c,pt->max*sizeof(CountInt));
+  }
+  pt->a[pt->n] = a;
+  pt->b[pt->n] = b;
+  pt->c[pt->n] = c;
+  pt->n++;
+}
+
+/* scanPairs: write the keys of pairs dist apart whose left 
+ * site lies in lo,...,hi-1 of a contig of len sites to keys 
+ * and return their number 
+ */
+KERNEL int scanPairs(Position *pb, int len, int lo, int hi, int dist, uint64_t *keys){
+  int a, b, e, l, r, s, n, m;
+
+  n = 0;
+  r = lo;
+  for(s=lo;s<hi;s=e){
+    e = runEnd(pb, len, s);
+    /* partners inside the gap-free run */
+    m = e - dist < hi ? e - dist : hi;
+    for(l=s;l<m;l++){
+      a = pb[l].pro;
+      b = pb[l+dist].pro;
+      keys[n++] = a < b ? PAIR_KEY(a,b) : PAIR_KEY(b,a);
+    }
+    /* partners beyond the run */
+    if(r < e)
+      r = e;
+    m = e < hi ? e : hi;
+    for(l=s>e-dist?s:e-dist;l<m;l++){
+      while(r<len && pb[r].pos - pb[l].pos < dist)
+	r++;
+      if(r < len && pb[r].pos - pb[l].pos == dist){
+	a = pb[l].pro;
+	b = pb[r].pro;
+	keys[n++] = a < b ? PAIR_KEY(a,b) : PAIR_KEY(b,a);
+      }
+    }
+  }
+  return n;
+}
+
+/* pairTableLik: log-likelihood of pairs lo,...,hi-1; the
+ * same computation as traverse in deltaComp.c 
+ */
+double pairTableLik(PairTable *pt, size_t lo, size_t hi, double *lOnes, double *lTwos, double *lScales,
+		    double h0, double h2, double complementHalf){
+  double l;
+
+  l = 0.;
+  pairTableLikK(pt, lo, hi, lOnes, lTwos, lScales, &h0, &h2, &complementHalf, 1, &l);
+  return l;
+}
+
+/* pairTableLikK: add the log-likelihoods of pairs lo,...,hi-1 
+ * under k sets of pair probabilities to l[0],...,l[k-1]; the 
+ * products of site likelihoods are computed once per pair 
+ */
+KERNEL void pairTableLikK(PairTable *pt, size_t lo, size_t hi, double *lOnes, double *lTwos, double *lScales,
+		   double *h0, double *h2, double *complementHalf, int k, double *l){
+  size_t i;
+  int j, a, b;
+  double p11, p22, p12, s, c, li;
+
+  for(i=lo;i<hi;i++){
+    a = pt->a[i];
+    b = pt->b[i];
+    p11 = lOnes[a]*lOnes[b];
+    p22 = lTwos[a]*lTwos[b];
+    p12 = lOnes[a]*lTwos[b]+lTwos[a]*lOnes[b];
+    s = lScales[a] + lScales[b];
+    c = pt->c[i];
+    for(j=0;j<k;j++){
+      li = h0[j]*p11 + h2[j]*p22 + complementHalf[j]*p12;
+      if(li>0)
+	l[j] += (log(li) + s) * c;
+      else
+	l[j] += (log(DBL_MIN) + s) * c;
+    }
+  }
+}
+
+/* pairTableLikAll: add the log-likelihoods of all pairs in pt 
+ * under k sets of pair probabilities to l[0],...,l[k-1]; the sum 
+ * runs in parallel through reduceSum
+ */
+void pairTableLikAll(PairTable *pt, double *lOnes, double *lTwos, double *lScales,
+		     double *h0, double *h2, double *complementHalf, int k, double *l){
+  PairLikData d;
+
+  d.pt = pt;
+  d.lOnes = lOnes;
+  d.lTwos = lTwos;
+  d.lScales = lScales;
+  d.h0 = h0;
+  d.h2 = h2;
+  d.complementHalf = complementHalf;
+  d.k = k;
+  reduceSum(pt->n, k, pairLikRange, &d, l);
+}
+
+void pairLikRange(size_t lo, size_t hi, void *data, double *l){
+  PairLikData *d;
+
+  d = (PairLikData *)data;
+  pairTableLikK(d->pt, lo, hi, d->lOnes, d->lTwos, d->lScales, d->h0, d->h2, 
+		d->complementHalf, d->k, l);
+}
+
+void freePairTable(PairTable *pt){
+  if(pt){
+    free(pt->a);
+    free(pt->b);
+    free(pt->c);
+    free(pt);
+  }
+}
+
+int cmpKey(const void *p1, const void *p2){
+  uint64_t k1, k2;
+
+  k1 = *(uint64_t *)p1;
+  k2 = *(uint64_t *)p2;
+  if(k1 < k2)
+    return -1;
+  else if(k1 > k2)
+    return 1;
+  return 0;
+}
@@ -0,0 +1,37 @@
+/***** pairTable.h ********************************
+ * Description: Header file for pairTable.c.
+ * License: GNU General Public
+ **************************************************/
+#ifndef PAIRTABLE
+#define PAIRTABLE
+#include <stdio.h>
+#include <stdint.h>
+#include "interface.h"
+#include "ld.h"
+
+/* pack the profile indexes of a pair into a single sort key */
+#define PAIR_KEY(a,b) (((uint64_t)(b) << 32) | (uint32_t)(a))
+#define KEY_A(k) ((int)((k) & 0xffffffff))
+#define KEY_B(k) ((int)((k) >> 32))
+
+typedef struct pairTable{ /* flat table of profile pairs: */
+  size_t n;               /* number of distinct pairs */
+  size_t max;             /* number of pairs allocated */
+  int *a;                 /* smaller profile index */
+  int *b;                 /* larger profile index */
+  CountInt *c;            /* number of occurrences */
+}PairTable;
+
+PairTable *newPairTable();
+void addPairKeys(PairTable *pt, uint64_t *keys, int n);
+void addPair(PairTable *pt, int a, int b, CountInt c);
+int scanPairs(Position *pb, int len, int lo, int hi, int dist, uint64_t *keys);
+double pairTableLik(PairTable *pt, size_t lo, size_t hi, double *lOnes, double *lTwos, double *lScales,
+		    double h0, double h2, double complementHalf);
+void pairTableLikK(PairTable *pt, size_t lo, size_t hi, double *lOnes, double *lTwos, double *lScales,
+		   double *h0, double *h2, double *complementHalf, int k, double *l);
+void pairTableLikAll(PairTable *pt, double *lOnes, double *lTwos, double *lScales,
+		     double *h0, double *h2, double *complementHalf, int k, double *l);
+void freePairTable(PairTable *pt);
+
+#endif
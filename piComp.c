@@ -10,30 +10,75 @@
  * Date: Tue Mar 17 21:20:57 2009
  ***************************************************/
 #include <float.h>
+#include <limits.h>
+#include <math.h>
+#include <stdlib.h>
 #include <gsl/gsl_errno.h>
 #include <gsl/gsl_math.h>
 #include <gsl/gsl_roots.h>
 #include <assert.h>
 #include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include "interface.h"
 #include "profile.h"
 #include "mlComp.h"
 #include "eprintf.h"
+#include "reduce.h"
+#include "trace.h"
 
 double *lOnes = NULL;
 double *lTwos = NULL;
+double *lScales = NULL;
 double numPos;
+char fastLik = 0;
+char *likMap = NULL;     /* mapped likelihood file, or NULL */
+size_t likMapLen = 0;
+char likMiss = 0;        /* current fit cacheable but not cached? */
+uint64_t sumHash;        /* hash of the database profiles */
+uint64_t parHash;        /* hash of the fit parameters */
+
+typedef struct likRecord{ /* header of a fit in a likelihood file: */
+  char tag[8];            /* LIK_TAG */
+  uint64_t sumHash;       /* hash of the .sum file */
+  uint64_t parHash;       /* hash of the fit parameters */
+  int64_t numProfiles;
+  Result result;
+}LikRecord;               /* followed by lOnes, lTwos, lScales */
+
+typedef struct likPData{ /* arguments of likPRange: */
+  PackedProfiles *pp;
+  int *order;            /* coverage order, or NULL */
+  int numFast;           /* profiles on the fast path */
+  double pi, ee;
+  double logPi, logCompPi;
+}LikPData;
+
+typedef struct siteLikData{ /* arguments of siteLikRange: */
+  PackedProfiles *pp;
+  double ee;
+}SiteLikData;
 
-double likP(Profile *profiles, int numProfiles, double pi, double ee);
+double likP(PackedProfiles *pp, int numProfiles, double pi, double ee);
 double myP(const gsl_vector *v, void *params);
+void likPRange(size_t lo, size_t hi, void *data, double *l);
 double myPconf(double x, void *params);
 double myEconf(double x, void *params);
 void confP(Args *args, Result *result);
 void confE(Args *args, Result *result);
-void compSiteLik(Profile *profiles, int numProfiles, double ee);
-FILE *openLikFile(char *baseName);
-Result *readLik(FILE *fp, int numProfiles, Result *result);
+void compSiteLik(PackedProfiles *pp, int numProfiles, double ee);
+void siteLikRange(size_t lo, size_t hi, void *data, double *unused);
+void likKey(char *baseName, Args *args);
+void parKey(Args *args);
+LikRecord *findLik(int numProfiles, int warm);
+uint64_t hashBytes(uint64_t h, void *p, size_t n);
+size_t mapLik(char *baseName);
+LikRecord *nextLikRecord(size_t *off);
+int lookupLik(char *baseName, Args *args, int numProfiles, Result *result);
+void momentEstimate(PackedProfiles *pp, int numProfiles, double *pi, double *ee);
+void alleleProbs(int c, double ee, double *one, double *single);
 
 /* estimatePi: estimate pi and epsilon using the Nelder-Mead
  * Simplex algorithm; code adapted from Galassi, M., Davies, 
@@ -41,7 +86,7 @@ Result *readLik(FILE *fp, int numProfiles, Result *result);
  * Rossi, F. (2005). GNU Scientific Library Reference Manual. 
  * Edition 1.6, for GSL Version 1.6, 17 March 2005, p 472f.
  */
-Result *estimatePi(Profile *profiles, int numProfiles, Args *args, Result *result){
+Result *estimatePi(PackedProfiles *pp, int numProfiles, Args *args, Result *result){
   size_t np;
   const gsl_multimin_fminimizer_type *T;
   gsl_multimin_fminimizer *s;
@@ -49,13 +94,13 @@ Result *estimatePi(Profile *profiles, int numProfiles, Args *args, Result *resul
   gsl_multimin_function minex_func;
   size_t iter;
   int status;
-  double size;
-  FILE *fp;
+  double size, pi, ee;
 
-  if((fp = openLikFile(args->n)) != NULL && !args->I){
-    result = readLik(fp,numProfiles,result);
-    fclose(fp);
-    return result;
+  if(args->x == 0. && !args->N && args->K <= 0 && args->X == INT_MAX){
+    likKey(args->n, args);
+    if(!args->I && lookupLik(args->n, args, numProfiles, result))
+      return result;
+    likMiss = 1;
   }
 
   np = 2;
@@ -64,15 +109,33 @@ Result *estimatePi(Profile *profiles, int numProfiles, Args *args, Result *resul
   iter = 0;
 
   /*set up likelihood computation */
-  iniMlComp(profiles, numProfiles);
+  traceBegin("iniMlComp", -1);
+  iniMlComp(pp, numProfiles);
+  traceEnd();
+  /* starting point */
+  pi = args->P;
+  ee = args->E;
+  if(args->F)
+    momentEstimate(pp, numProfiles, &pi, &ee);
+  if(args->f){
+    iniFastLik(pp, numProfiles);
+    fastLik = checkFastLik(pi, ee);
+    if(!fastLik)
+      printf("WARNING: Single precision likelihoods deviate from double precision; fast path disabled.\n");
+  }
   /* initialize vertex size vector */
   ss = gsl_vector_alloc(np);
-  /* set all step sizes */
-  gsl_vector_set_all(ss, args->s);
-  /* starting point */
   x = gsl_vector_alloc(np);
-  gsl_vector_set(x, 0, args->P);
-  gsl_vector_set(x, 1, args->E);
+  gsl_vector_set(x, 0, pi);
+  gsl_vector_set(x, 1, ee);
+  /* set step sizes; an explicit -s applies to moment estimates, too */
+  if(args->s > 0)
+    gsl_vector_set_all(ss, args->s);
+  else if(args->F){
+    gsl_vector_set(ss, 0, MOM_STEP * pi);
+    gsl_vector_set(ss, 1, MOM_STEP * ee);
+  }else
+    gsl_vector_set_all(ss, STEP_SIZE);
   /* initialize method and iterate */
   minex_func.f = &myP;
   minex_func.n = np;
@@ -81,7 +144,9 @@ Result *estimatePi(Profile *profiles, int numProfiles, Args *args, Result *resul
   gsl_multimin_fminimizer_set(s, &minex_func, x, ss);
   do{
     iter++;
+    traceBegin("fitIteration", iter);
     status = gsl_multimin_fminimizer_iterate(s);
+    traceEnd();
     if(status)
       break;
     size = gsl_multimin_fminimizer_size(s);
@@ -95,12 +160,20 @@ Result *estimatePi(Profile *profiles, int numProfiles, Args *args, Result *resul
   result->l = s->fval;
   result->i = iter;
   gsl_set_error_handler_off();
-  confP(args, result);
-  confE(args, result);
+  if(args->x == 0.){ /* subsamples give no intervals */
+    traceBegin("confP", -1);
+    confP(args, result);
+    traceEnd();
+    traceBegin("confE", -1);
+    confE(args, result);
+    traceEnd();
+  }
   gsl_vector_free(x);
   gsl_vector_free(ss);
   gsl_multimin_fminimizer_free(s);
-  compSiteLik(getProfiles(),getNumProfiles(),result->ee);
+  traceBegin("compSiteLik", -1);
+  compSiteLik(pp,numProfiles,result->ee);
+  traceEnd();
   return result;
 }
 /* myF: function called during the minimization procedure */
@@ -114,47 +187,129 @@ double myP(const gsl_vector* v, void *params){
   if(pi < 0 || ee < 0 || pi > 1 || ee > 1){
     return DBL_MAX;
   }
-  likelihood = likP(getProfiles(), getNumProfiles(), pi, ee);
+  likelihood = likP(getPackedProfiles(), getNumProfiles(), pi, ee);
   return -likelihood;
 }
 
-double likP(Profile *profiles, int numProfiles, double pi, double ee){
-  int i;
-  int *coverages;
-  double l, likelihood, lOneLoc, lTwoLoc;
+/* likP: log-likelihood of pi and ee; profiles with low coverage
+ * are taken from the single precision fast path if enabled; the
+ * sum runs in parallel through reduceSum
+ */
+double likP(PackedProfiles *pp, int numProfiles, double pi, double ee){
+  LikPData d;
+  double likelihood;
 
-  coverages = getCoverages();
-  likelihood = 0.;
-  for(i=0;i<numProfiles;i++){
-    lOneLoc = lOne(coverages[i],profiles[i].profile,ee);
-    lTwoLoc = lTwo(coverages[i],profiles[i].profile,ee);
-    l = lOneLoc * (1.0 - pi) + lTwoLoc * pi;
-    if(l>0)
-      likelihood += log(l) * profiles[i].n;
+  d.pp = pp;
+  d.order = NULL;
+  d.numFast = 0;
+  if(fastLik && !fastLikValid(pi, ee)){
+    fastLik = 0;
+    printf("WARNING: Single precision likelihoods deviate from double precision at epsilon = %g; fast path disabled.\n",ee);
+  }
+  if(fastLik){
+    d.numFast = numFastProfiles(ee);
+    d.order = getCovOrder();
   }
+  d.pi = pi;
+  d.ee = ee;
+  d.logPi = log(pi);
+  d.logCompPi = log(1.0 - pi);
+  likelihood = 0.;
+  traceBegin("likP", -1);
+  reduceSum(numProfiles, 1, likPRange, &d, &likelihood);
+  traceEnd();
   return likelihood;
 }
 
-void compSiteLik(Profile *profiles, int numProfiles, double ee){
-  int i;
-  int *coverages;
+/* likPRange: add the log-likelihood of profiles lo,...,hi-1 to l */
+void likPRange(size_t lo, size_t hi, void *data, double *l){
+  LikPData *d;
+  PackedProfiles *pp;
+  uint16_t *c0, *c1, *c2, *c3;
+  double t[2];
+  int i, j, *w;
+
+  d = (LikPData *)data;
+  if(lo < (size_t)d->numFast){
+    l[0] += likPFast(lo, hi < (size_t)d->numFast ? hi : (size_t)d->numFast, d->pi, d->ee);
+    lo = d->numFast;
+  }
+  pp = d->pp;
+  c0 = pp->count[0];
+  c1 = pp->count[1];
+  c2 = pp->count[2];
+  c3 = pp->count[3];
+  for(j=lo;j<hi;j++){
+    i = d->order ? d->order[j] : j;
+    if(pp->num[i] == 0)       /* masked or not sampled; may be -inf */
+      continue;
+    if(pp->cov[i] < PACK_WIDE){
+      t[0] = d->logCompPi + logLOne(pp->cov[i],c0[i],c1[i],c2[i],c3[i],d->ee);
+      t[1] = d->logPi + logLTwo(pp->cov[i],c0[i],c1[i],c2[i],c3[i],d->ee);
+    }else{
+      w = wideProfile(pp, i);
+      t[0] = d->logCompPi + logLOne(pp->cov[i],w[0],w[1],w[2],w[3],d->ee);
+      t[1] = d->logPi + logLTwo(pp->cov[i],w[0],w[1],w[2],w[3],d->ee);
+    }
+    l[0] += logSumExp(t, 2) * pp->num[i];
+  }
+}
+
+/* compSiteLik: compute the site likelihoods given ee; they are 
+ * stored scaled by their maximum, the log of which goes to lScales 
+ */
+void compSiteLik(PackedProfiles *pp, int numProfiles, double ee){
+  SiteLikData d;
 
   lOnes = (double *)emalloc(numProfiles*sizeof(double));
   lTwos = (double *)emalloc(numProfiles*sizeof(double));
-  coverages = getCoverages();
-  for(i=0;i<numProfiles;i++){
-    lOnes[i] = lOne(coverages[i],profiles[i].profile,ee);
-    lTwos[i] = lTwo(coverages[i],profiles[i].profile,ee);
+  lScales = (double *)emalloc(numProfiles*sizeof(double));
+  d.pp = pp;
+  d.ee = ee;
+  parallelFor(numProfiles, siteLikRange, &d);
+}
+
+/* siteLikRange: site likelihoods of profiles lo,...,hi-1 */
+void siteLikRange(size_t lo, size_t hi, void *data, double *unused){
+  SiteLikData *d;
+  PackedProfiles *pp;
+  uint16_t *c0, *c1, *c2, *c3;
+  double l1, l2, m;
+  int i, *w;
+
+  d = (SiteLikData *)data;
+  pp = d->pp;
+  c0 = pp->count[0];
+  c1 = pp->count[1];
+  c2 = pp->count[2];
+  c3 = pp->count[3];
+  for(i=lo;i<hi;i++){
+    if(pp->cov[i] < PACK_WIDE){
+      l1 = logLOne(pp->cov[i],c0[i],c1[i],c2[i],c3[i],d->ee);
+      l2 = logLTwo(pp->cov[i],c0[i],c1[i],c2[i],c3[i],d->ee);
+    }else{
+      w = wideProfile(pp, i);
+      l1 = logLOne(pp->cov[i],w[0],w[1],w[2],w[3],d->ee);
+      l2 = logLTwo(pp->cov[i],w[0],w[1],w[2],w[3],d->ee);
+    }
+    m = l1 > l2 ? l1 : l2;
+    if(m == -INFINITY){
+      lOnes[i] = lTwos[i] = lScales[i] = 0.;
+    }else{
+      lOnes[i] = exp(l1 - m);
+      lTwos[i] = exp(l2 - m);
+      lScales[i] = m;
+    }
   }
 }
 
-double piComp_getNumPos(Profile *profiles, int numProfiles){
+double piComp_getNumPos(PackedProfiles *pp, int numProfiles){
   int i;
   
-  if(profiles){
+  if(pp){
     numPos = 0;
     for(i=0;i<numProfiles;i++)
-      numPos += profiles[i].n;
+      numPos += pp->num[i];
   }
   return numPos;
 }
@@ -166,7 +321,7 @@ double myPconf(double x, void *params){
 
   res = (Result *)params;
 
-  likelihood = likP(getProfiles(), getNumProfiles(), x, res->ee);
+  likelihood = likP(getPackedProfiles(), getNumProfiles(), x, res->ee);
 
   return likelihood + res->l + 2;
 }
@@ -178,7 +333,7 @@ double myEconf(double x, void *params){
   double likelihood;
 
   res = (Result *)params;
-  likelihood = likP(getProfiles(), getNumProfiles(), res->pi, x);
+  likelihood = likP(getPackedProfiles(), getNumProfiles(), res->pi, x);
 
   l =  likelihood + res->l + 2;
   return l;
@@ -194,6 +349,8 @@ void confE(Args *args, Result *result){
   gsl_function fun;
   double xLo, xHi;
 
+  if(args->q && curvBounds(myEconf, result, result->ee, 0., 0.5, &result->eLo, &result->eUp))
+    return;
   fun.function = &myEconf;
   fun.params = result;
 
@@ -248,6 +405,8 @@ void confP(Args *args, Result *result){
   gsl_function fun;
   double xLo, xHi;
 
+  if(args->q && curvBounds(myPconf, result, result->pi, 0., 0.75, &result->pLo, &result->pUp))
+    return;
   fun.function = &myPconf;
   fun.params = result;
 
@@ -299,81 +458,388 @@ double *getLtwos(){
   return lTwos;
 }
 
+double *getLscales(){
+  return lScales;
+}
 
-void writeLik(char *baseName, Result *result){
-  char *fileName;
-  int n;
-  double np;
+
+/* likKey: hash the contents of baseName.sum and the parameters 
+ * the fit of pi and ee depends on; FNV-1a, 64 bits 
+ */
+void likKey(char *baseName, Args *args){
+  sumHash = hashSum(baseName);
+  parKey(args);
+}
+
+/* hashSum: hash the contents of baseName.sum */
+uint64_t hashSum(char *baseName){
+  char *fileName, buf[BUFSIZ];
+  uint64_t h;
+  size_t n;
   FILE *fp;
 
+  fileName = (char *)emalloc(256*sizeof(char));
+  fileName = strcpy(fileName,baseName);
+  fileName = strcat(fileName,".sum");
+  fp = efopen(fileName,"rb");
+  h = LIK_HASH_INI;
+  while((n = fread(buf,sizeof(char),BUFSIZ,fp)) > 0)
+    h = hashBytes(h, buf, n);
+  fclose(fp);
+  free(fileName);
+  return h;
+}
+
+/* parKey: hash the parameters the fit of pi and ee depends on */
+void parKey(Args *args){
+  double d[4];
+  int p[5];
+
+  d[0] = args->P;
+  d[1] = args->E;
+  d[2] = args->t;
+  d[3] = args->s;
+  p[0] = args->i;
+  p[1] = args->F;
+  p[2] = args->f;
+  p[3] = args->q;
+  p[4] = args->u ? args->c : 0;
+  parHash = hashBytes(LIK_HASH_INI, d, sizeof(d));
+  parHash = hashBytes(parHash, p, sizeof(p));
+}
+
+uint64_t hashBytes(uint64_t h, void *p, size_t n){
+  unsigned char *c;
+  size_t i;
+
+  c = (unsigned char *)p;
+  for(i=0;i<n;i++)
+    h = (h ^ c[i]) * LIK_HASH_MUL;
+  return h;
+}
+
+/* mapLik: map baseName.lik into memory; return its length, or 0 
+ * if there is no such file
+ */
+size_t mapLik(char *baseName){
+  char *fileName;
+  struct stat stbuf;
+  int fd;
+
   fileName = (char *)emalloc(256*sizeof(char));
   fileName = strcpy(fileName,baseName);
   fileName = strcat(fileName,".lik");
+  likMap = NULL;
+  likMapLen = 0;
+  if((fd = open(fileName,O_RDONLY)) != -1){
+    if(fstat(fd,&stbuf) == 0 && stbuf.st_size > 0){
+      likMap = mmap(NULL,stbuf.st_size,PROT_READ,MAP_PRIVATE,fd,0);
+      if(likMap == MAP_FAILED)
+	eprintf("could not map %s:",fileName);
+      likMapLen = stbuf.st_size;
+    }
+    close(fd);
+  }
+  free(fileName);
+  return likMapLen;
+}
 
-  fp = efopen(fileName,"wb");
-  n = fwrite("lik",sizeof(char),3,fp);
-  assert(n == 3);
-  n = fwrite(result,sizeof(Result),1,fp);
-  assert(n == 1);
+/* nextLikRecord: the record following the one at offset off of 
+ * the mapped likelihood file, or NULL; off is updated
+ */
+LikRecord *nextLikRecord(size_t *off){
+  LikRecord *rec;
+  size_t size;
+
+  if(*off + sizeof(LikRecord) > likMapLen)
+    return NULL;
+  rec = (LikRecord *)(likMap + *off);
+  if(memcmp(rec->tag,LIK_TAG,sizeof(rec->tag)) != 0)
+    return NULL;
+  size = sizeof(LikRecord) + 3*(size_t)rec->numProfiles*sizeof(double);
+  if(*off + size > likMapLen)
+    return NULL;
+  *off += size;
+  return rec;
+}
+
+/* lookupLik: look up the site likelihoods of the current database
+ * and fit parameters, as hashed by likKey, in the mapped 
+ * likelihood file and return 1; 
+ * otherwise, unless pi and ee start from -P or -E, start their 
+ * search at the estimates of the database under other parameters 
+ * and rehash the parameters, and return 0 
+ */
+int lookupLik(char *baseName, Args *args, int numProfiles, Result *result){
+  LikRecord *rec, *warm;
+
+  if(mapLik(baseName) == 0)
+    return 0;
+  rec = findLik(numProfiles, 0);
+  if(rec == NULL && args->F && (warm = findLik(numProfiles, 1)) != NULL){
+    args->P = warm->result.pi;
+    args->E = warm->result.ee;
+    args->F = 0;
+    parKey(args);
+    rec = findLik(numProfiles, 0);
+  }
+  if(rec != NULL){
+    assert(lOnes == NULL);
+    *result = rec->result;
+    lOnes = (double *)(rec + 1);
+    lTwos = lOnes + numProfiles;
+    lScales = lTwos + numProfiles;
+    return 1;
+  }
+  munmap(likMap, likMapLen);
+  likMap = NULL;
+  return 0;
+}
+
+/* findLik: first record of the current database and fit parameters 
+ * in the mapped likelihood file; with warm set, first record of the 
+ * current database, including records carried over by carryLik, 
+ * whose estimates can start a search; NULL if none 
+ */
+LikRecord *findLik(int numProfiles, int warm){
+  LikRecord *rec;
+  size_t off;
+  Result *r;
+
+  off = 0;
+  while((rec = nextLikRecord(&off)) != NULL){
+    if(rec->sumHash != sumHash)
+      continue;
+    r = &rec->result;
+    if(!warm && rec->parHash == parHash && rec->numProfiles == numProfiles)
+      return rec;
+    if(warm && r->pi > 0 && r->pi < 1 && r->ee > 0 && r->ee < 1)
+      return rec;
+  }
+  return NULL;
+}
+
+/* likMissed: was the current fit cacheable but not found in, or not
+ * looked up in, the likelihood file? 
+ */
+int likMissed(){
+  return likMiss;
+}
+
+/* writeLik: add the result and site likelihoods of the current 
+ * database and fit parameters to baseName.lik; records of other 
+ * parameters are kept, records of other databases dropped 
+ */
+void writeLik(char *baseName, Result *result){
+  char *fileName, *tmpName;
+  LikRecord *rec, head;
+  size_t off, start, n, np;
+  FILE *fp;
+
+  fileName = (char *)emalloc(256*sizeof(char));
+  fileName = strcpy(fileName,baseName);
+  fileName = strcat(fileName,".lik");
+  tmpName = (char *)emalloc(256*sizeof(char));
+  tmpName = strcpy(tmpName,fileName);
+  tmpName = strcat(tmpName,".tmp");
+  fp = efopen(tmpName,"wb");
+  if(likMap == NULL && mapLik(baseName) > 0){
+    off = 0;
+    start = 0;
+    while((rec = nextLikRecord(&off)) != NULL){
+      if(rec->sumHash == sumHash && rec->parHash != parHash){
+	n = fwrite(likMap + start,sizeof(char),off - start,fp);
+	assert(n == off - start);
+      }
+      start = off;
+    }
+    munmap(likMap, likMapLen);
+    likMap = NULL;
+  }
   np = getNumProfiles();
-  n = fwrite(&np,sizeof(double),1,fp);
+  memset(&head,0,sizeof(LikRecord));
+  memcpy(head.tag,LIK_TAG,sizeof(head.tag));
+  head.sumHash = sumHash;
+  head.parHash = parHash;
+  head.numProfiles = np;
+  head.result = *result;
+  n = fwrite(&head,sizeof(LikRecord),1,fp);
   assert(n == 1);
-  n = fwrite(getLones(),sizeof(double),getNumProfiles(),fp);
-  assert(n == getNumProfiles());
-  n = fwrite(getLtwos(),sizeof(double),getNumProfiles(),fp);
-  assert(n == getNumProfiles());
+  n = fwrite(getLones(),sizeof(double),np,fp);
+  assert(n == np);
+  n = fwrite(getLtwos(),sizeof(double),np,fp);
+  assert(n == np);
+  n = fwrite(getLscales(),sizeof(double),np,fp);
+  assert(n == np);
+  fclose(fp);
+  if(rename(tmpName,fileName) != 0)
+    eprintf("rename(%s, %s) failed:",tmpName,fileName);
+  likMiss = 0;
   printf("#Likelihoods written to %s\n",fileName);
+  free(tmpName);
   free(fileName);
-  fclose(fp);
 }
 
-FILE *openLikFile(char *baseName){
-  char *fileName;
+/* carryLik: after baseName.sum, whose hash was oldSum, has been 
+ * rewritten, keep the estimates of the old records in baseName.lik 
+ * as warm starts for the new database; the site likelihoods are 
+ * dropped, the records carried are marked by parHash LIK_WARM and 
+ * numProfiles 0, so they never serve as a cache hit 
+ */
+void carryLik(char *baseName, uint64_t oldSum){
+  char *fileName, *tmpName;
+  LikRecord *rec, head;
+  size_t off, n;
+  uint64_t newSum;
   FILE *fp;
-  struct stat stbuf;
-  int n;
-  char *tag;
 
+  if(mapLik(baseName) == 0)
+    return;
+  newSum = hashSum(baseName);
   fileName = (char *)emalloc(256*sizeof(char));
-  tag = (char *)emalloc(4*sizeof(char));
   fileName = strcpy(fileName,baseName);
   fileName = strcat(fileName,".lik");
-  if(stat(fileName,&stbuf) != -1){
-    fp = efopen(fileName,"rb");
-    n = fread(tag,sizeof(char),3,fp);
-    tag[3] = '\0';
-    assert(n == 3);
-    if(strcmp(tag,"lik") != 0){
-      assert(0);
-    }
-  }else
-    fp = NULL;
-  free(tag);
+  tmpName = (char *)emalloc(256*sizeof(char));
+  tmpName = strcpy(tmpName,fileName);
+  tmpName = strcat(tmpName,".tmp");
+  fp = efopen(tmpName,"wb");
+  off = 0;
+  while((rec = nextLikRecord(&off)) != NULL){
+    if(rec->sumHash != oldSum)
+      continue;
+    head = *rec;
+    head.sumHash = newSum;
+    head.parHash = LIK_WARM;
+    head.numProfiles = 0;
+    n = fwrite(&head,sizeof(LikRecord),1,fp);
+    assert(n == 1);
+  }
+  fclose(fp);
+  munmap(likMap, likMapLen);
+  likMap = NULL;
+  if(rename(tmpName,fileName) != 0)
+    eprintf("rename(%s, %s) failed:",tmpName,fileName);
+  free(tmpName);
   free(fileName);
-  return fp;
 }
 
-Result *readLik(FILE *fp, int numProfiles, Result *result){
-  int n, i, sod;
-  double np;
+/* freeSiteLik: free the site likelihoods, or unmap them if they 
+ * were read from a likelihood file 
+ */
+void freeSiteLik(){
+  if(likMap){
+    munmap(likMap, likMapLen);
+    likMap = NULL;
+  }else{
+    free(lOnes);
+    free(lTwos);
+    free(lScales);
+  }
+  lOnes = lTwos = lScales = NULL;
+}
 
-  assert(lOnes == NULL);
-  assert(lTwos == NULL);
-  fseek(fp,3,SEEK_SET);
-  n = fread(result,sizeof(Result),1,fp);
-  assert(n == 1);
-  sod = sizeof(double);
-  n = fread(&np,sod,1,fp);
-  assert(n == 1 && np == numProfiles);
-  lOnes = (double *)emalloc(numProfiles*sod);
-  lTwos = (double *)emalloc(numProfiles*sod);
+/* momentEstimate: starting values of pi and ee from the fractions
+ * of sites showing one allele and showing two alleles, one of them
+ * in a single read, at each coverage; ee is solved from the second,
+ * given pi, and pi from the first, given ee, until neither changes
+ */
+void momentEstimate(PackedProfiles *pp, int numProfiles, double *pi, double *ee){
+  int i, j, c, d, m, maxC, iter, p[4];
+  double *w, one[2], single[2];
+  double a, b, x1, xs, lo, hi, e, p0, t, cov, n;
+
+  maxC = 0;
+  for(i=0;i<numProfiles;i++)
+    if(pp->cov[i] > maxC)
+      maxC = pp->cov[i];
+  w = (double *)emalloc((maxC+1)*sizeof(double));
+  for(c=0;c<=maxC;c++)
+    w[c] = 0.;
+  x1 = xs = cov = n = 0.;
   for(i=0;i<numProfiles;i++){
-    n = fread(&lOnes[i],sod,1,fp);
-    assert(n == 1);
+    c = pp->cov[i];
+    unpackProfile(pp, i, p);
+    d = 0;
+    m = c;
+    for(j=0;j<4;j++)
+      if(p[j]){
+	d++;
+	if(p[j] < m)
+	  m = p[j];
+      }
+    w[c] += pp->num[i];
+    cov += (double)c * pp->num[i];
+    n += pp->num[i];
+    if(d == 1)
+      x1 += pp->num[i];
+    else if(d == 2 && m == 1)
+      xs += pp->num[i];
   }
-  for(i=0;i<numProfiles;i++){
-    n = fread(&lTwos[i],sod,1,fp);
-    assert(n == 1);
+  *pi = INI_PI;
+  *ee = INI_EPSILON;
+  for(iter=0;iter<MOM_ITER;iter++){
+    p0 = *pi;
+    /* ee from the sites with a single read of a second allele; 
+     * their expected number increases with ee up to 1/coverage */
+    lo = MOM_MIN;
+    hi = n / cov < 0.5 ? n / cov : 0.5;
+    for(i=0;i<MOM_ITER;i++){
+      e = (lo + hi) / 2.;
+      t = 0.;
+      for(c=2;c<=maxC;c++){
+	if(w[c] == 0.)
+	  continue;
+	alleleProbs(c, e, one, single);
+	t += w[c] * ((1. - *pi) * single[0] + *pi * single[1]);
+      }
+      if(t < xs)
+	lo = e;
+      else
+	hi = e;
+    }
+    *ee = (lo + hi) / 2.;
+    /* pi from the sites with one allele */
+    a = b = 0.;
+    for(c=1;c<=maxC;c++){
+      if(w[c] == 0.)
+	continue;
+      alleleProbs(c, *ee, one, single);
+      a += w[c] * one[0];
+      b += w[c] * one[1];
+    }
+    if(a - b > 0.)
+      *pi = (a - x1) / (a - b);
+    if(*pi < MOM_MIN)
+      *pi = MOM_MIN;
+    if(*pi > 0.5)
+      *pi = 0.5;
+    if(fabs(*pi - p0) <= MOM_MIN * p0)
+      break;
+  }
+  free(w);
+}
+
+/* alleleProbs: probabilities that c reads at a homozygous (index 0)
+ * and a heterozygous (index 1) site with error rate ee show one 
+ * nucleotide, and show two nucleotides, one of them in a single read
+ */
+void alleleProbs(int c, double ee, double *one, double *single){
+  double q[2][4];
+  int h, i, j;
+
+  q[0][0] = 1. - ee;
+  q[0][1] = q[0][2] = q[0][3] = ee / 3.;
+  q[1][0] = q[1][1] = (1. - 2. * ee / 3.) / 2.;
+  q[1][2] = q[1][3] = ee / 3.;
+  for(h=0;h<2;h++){
+    one[h] = single[h] = 0.;
+    for(i=0;i<4;i++){
+      one[h] += pow(q[h][i], c);
+      for(j=0;j<4;j++)
+	if(j != i && c > 1)
+	  single[h] += c * q[h][j] * pow(q[h][i], c-1);
+    }
+    if(c == 2)  /* one read each is counted twice */
+      single[h] /= 2.;
   }
-  return result;
 }
@@ -10,16 +10,34 @@
 #include "eprintf.h"
 #include "profile.h"
 
-void setNumProfiles(int numProfiles);
-void setProfiles(Profile *profiles);
+void readPacked(FILE *fp, Profile *profiles, int numProfiles);
+void writePacked(FILE *fp, Profile *profiles, int numProfiles);
 
-Profile *thisProfiles;
+PackedProfiles *thisPacked;
 int thisNumProfiles;
 
+/* readProfiles: read the profiles in baseName.sum into the packed 
+ * store; the profiles as read are not kept 
+ */
 void readProfiles(char *baseName){
-  char *fileName, tag;
-  int i, numProfiles, numRead, sop;
   Profile *profiles;
+  int numProfiles;
+
+  profiles = loadProfiles(baseName, &numProfiles);
+  setPackedProfiles(packProfiles(profiles, numProfiles));
+  setNumProfiles(numProfiles);
+  free(profiles);
+}
+
+/* loadProfiles: read the profiles in baseName.sum, which are 
+ * stored in the 32-bit (tag "sum"), 64-bit (tag "s64"), or 
+ * packed (tag "p16") format 
+ */
+Profile *loadProfiles(char *baseName, int *num){
+  char *fileName, tag[4];
+  int i, j, numProfiles, numRead, wide, packed;
+  Profile *profiles;
+  Profile32 p;
   FILE *fp;
 
   fileName = (char *)emalloc(256*sizeof(char));
@@ -27,29 +45,229 @@ void readProfiles(char *baseName){
   fileName = strcat(fileName,".sum");
 
   fp = efopen(fileName,"rb");
-  for(i=0;i<3;i++)
-    numRead = fread(&tag,sizeof(char),1,fp);
-  assert(numRead == 1);
+  numRead = fread(tag,sizeof(char),3,fp);
+  assert(numRead == 3);
+  tag[3] = '\0';
+  wide = strcmp(tag,"s64") == 0;
+  packed = strcmp(tag,"p16") == 0;
+#ifndef VER64
+  if(wide)
+    eprintf("%s is in the 64-bit format; please use a 64-bit build of %s (make VER=64).",fileName,progname());
+#endif
   numRead = fread(&numProfiles,sizeof(int),1,fp);
   assert(numRead == 1);
-  sop = sizeof(Profile);
-  profiles = (Profile *)emalloc(numProfiles*sop);
+  profiles = (Profile *)emalloc((numProfiles+1)*sizeof(Profile));
+  if(packed)
+    readPacked(fp, profiles, numProfiles);
+  else if(wide || sizeof(Profile) == sizeof(Profile32)){
+    numRead = fread(profiles,sizeof(Profile),numProfiles,fp);
+    assert(numRead == numProfiles);
+  }else
+    for(i=0;i<numProfiles;i++){
+      numRead = fread(&p,sizeof(Profile32),1,fp);
+      assert(numRead == 1);
+      for(j=0;j<4;j++)
+	profiles[i].profile[j] = p.profile[j];
+      profiles[i].n = p.n;
+    }
+  fclose(fp);
+  free(fileName);
+  *num = numProfiles;
+
+  return profiles;
+}
+
+/* writeProfiles: write profiles to baseName.sum; with pack set, the
+ * packed format is used if all allele counts fit into 16 bits; 
+ * otherwise the 64-bit format only if a number of occurrence does 
+ * not fit into the 32-bit format 
+ */
+void writeProfiles(char *baseName, Profile *profiles, int numProfiles, int pack){
+  char *fileName;
+  int i, j, n, wide, packed;
+  Profile32 p;
+  FILE *fp;
+
+  wide = 0;
+  packed = pack;
   for(i=0;i<numProfiles;i++){
-    numRead = fread(&profiles[i],sop,1,fp);
-    assert(numRead == 1);
+    if(profiles[i].n > INT32_MAX)
+      wide = 1;
+    for(j=0;j<4;j++)
+      if(profiles[i].profile[j] > UINT16_MAX)
+	packed = 0;
   }
-  setProfiles(profiles);
-  setNumProfiles(numProfiles);
+  fileName = (char *)emalloc(256*sizeof(char));
+  fileName = strcpy(fileName,baseName);
+  fileName = strcat(fileName,".sum");
+  fp = efopen(fileName,"wb");
+  n = fwrite(packed ? "p16" : wide ? "s64" : "sum",sizeof(char),3,fp);
+  assert(n == 3);
+  n = fwrite(&numProfiles,sizeof(int),1,fp);
+  assert(n == 1);
+  if(packed)
+    writePacked(fp, profiles, numProfiles);
+  else if(wide || sizeof(Profile) == sizeof(Profile32)){
+    n = fwrite(profiles,sizeof(Profile),numProfiles,fp);
+    assert(n == numProfiles);
+  }else
+    for(i=0;i<numProfiles;i++){
+      for(j=0;j<4;j++)
+	p.profile[j] = profiles[i].profile[j];
+      p.n = profiles[i].n;
+      n = fwrite(&p,sizeof(Profile32),1,fp);
+      assert(n == 1);
+    }
   fclose(fp);
   free(fileName);
 }
 
-void setProfiles(Profile *profiles){
-  thisProfiles = profiles;
+/* readPacked: read profiles in the packed format, that is four 
+ * columns of 16-bit allele counts followed by a column of 64-bit
+ * numbers of occurrence 
+ */
+void readPacked(FILE *fp, Profile *profiles, int numProfiles){
+  uint16_t *c;
+  int64_t *n;
+  int i, j, numRead;
+
+  c = (uint16_t *)emalloc((numProfiles+1)*sizeof(uint16_t));
+  for(j=0;j<4;j++){
+    numRead = fread(c,sizeof(uint16_t),numProfiles,fp);
+    assert(numRead == numProfiles);
+    for(i=0;i<numProfiles;i++)
+      profiles[i].profile[j] = c[i];
+  }
+  free(c);
+  n = (int64_t *)emalloc((numProfiles+1)*sizeof(int64_t));
+  numRead = fread(n,sizeof(int64_t),numProfiles,fp);
+  assert(numRead == numProfiles);
+  for(i=0;i<numProfiles;i++){
+#ifndef VER64
+    if(n[i] > INT32_MAX)
+      eprintf("a profile occurs more than %d times; please use a 64-bit build of %s (make VER=64).",INT32_MAX,progname());
+#endif
+    profiles[i].n = n[i];
+  }
+  free(n);
+}
+
+/* writePacked: write profiles in the packed format */
+void writePacked(FILE *fp, Profile *profiles, int numProfiles){
+  uint16_t *c;
+  int64_t *n;
+  int i, j, numWritten;
+
+  c = (uint16_t *)emalloc((numProfiles+1)*sizeof(uint16_t));
+  for(j=0;j<4;j++){
+    for(i=0;i<numProfiles;i++)
+      c[i] = profiles[i].profile[j];
+    numWritten = fwrite(c,sizeof(uint16_t),numProfiles,fp);
+    assert(numWritten == numProfiles);
+  }
+  free(c);
+  n = (int64_t *)emalloc((numProfiles+1)*sizeof(int64_t));
+  for(i=0;i<numProfiles;i++)
+    n[i] = profiles[i].n;
+  numWritten = fwrite(n,sizeof(int64_t),numProfiles,fp);
+  assert(numWritten == numProfiles);
+  free(n);
+}
+
+/* packProfiles: store the profiles by column with 16-bit allele 
+ * counts; the counts of wide profiles, whose coverage may not fit
+ * into 16 bits, are kept in a separate list 
+ */
+PackedProfiles *packProfiles(Profile *profiles, int numProfiles){
+  PackedProfiles *pp;
+  int i, j, c, maxWide;
+
+  pp = (PackedProfiles *)emalloc(sizeof(PackedProfiles));
+  pp->n = numProfiles;
+  for(j=0;j<4;j++)
+    pp->count[j] = (uint16_t *)emalloc((numProfiles+1)*sizeof(uint16_t));
+  pp->cov = (int *)emalloc((numProfiles+1)*sizeof(int));
+  pp->num = (int64_t *)emalloc((numProfiles+1)*sizeof(int64_t));
+  pp->numWide = 0;
+  pp->wideId = NULL;
+  pp->wideCount = NULL;
+  maxWide = 0;
+  for(i=0;i<numProfiles;i++){
+    c = 0;
+    for(j=0;j<4;j++)
+      c += profiles[i].profile[j];
+    pp->cov[i] = c;
+    pp->num[i] = profiles[i].n;
+    if(c < PACK_WIDE){
+      for(j=0;j<4;j++)
+	pp->count[j][i] = profiles[i].profile[j];
+      continue;
+    }
+    for(j=0;j<4;j++)
+      pp->count[j][i] = 0;
+    if(pp->numWide == maxWide){
+      maxWide = 2*maxWide + 16;
+      pp->wideId = (int *)erealloc(pp->wideId,maxWide*sizeof(int));
+      pp->wideCount = (int *)erealloc(pp->wideCount,4*maxWide*sizeof(int));
+    }
+    pp->wideId[pp->numWide] = i;
+    for(j=0;j<4;j++)
+      pp->wideCount[4*pp->numWide+j] = profiles[i].profile[j];
+    pp->numWide++;
+  }
+  return pp;
+}
+
+/* unpackProfile: copy the allele counts of packed profile i */
+void unpackProfile(PackedProfiles *pp, int i, int *profile){
+  int j, *w;
+
+  if(pp->cov[i] >= PACK_WIDE){
+    w = wideProfile(pp, i);
+    for(j=0;j<4;j++)
+      profile[j] = w[j];
+  }else
+    for(j=0;j<4;j++)
+      profile[j] = pp->count[j][i];
 }
 
-Profile *getProfiles(){
-  return thisProfiles;
+/* wideProfile: allele counts of wide profile i */
+int *wideProfile(PackedProfiles *pp, int i){
+  int lo, hi, mid;
+
+  lo = 0;
+  hi = pp->numWide - 1;
+  while(lo < hi){
+    mid = (lo + hi) / 2;
+    if(pp->wideId[mid] < i)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  assert(pp->wideId[lo] == i);
+  return pp->wideCount + 4*lo;
+}
+
+void freePackedProfiles(PackedProfiles *pp){
+  int j;
+
+  if(pp == NULL)
+    return;
+  for(j=0;j<4;j++)
+    free(pp->count[j]);
+  free(pp->cov);
+  free(pp->num);
+  free(pp->wideId);
+  free(pp->wideCount);
+  free(pp);
+}
+
+void setPackedProfiles(PackedProfiles *pp){
+  thisPacked = pp;
+}
+
+PackedProfiles *getPackedProfiles(){
+  return thisPacked;
 }
 
 void setNumProfiles(int numProfiles){
@@ -59,3 +277,20 @@ void setNumProfiles(int numProfiles){
 int getNumProfiles(){
   return thisNumProfiles;
 }
+
+/* coverageMask: mask of the profiles with coverage outside 
+ * [minCov,maxCov]; their numbers of occurrence are set to zero
+ */
+char *coverageMask(PackedProfiles *pp, int minCov, int maxCov){
+  char *mask;
+  int i, c;
+
+  mask = (char *)emalloc(pp->n+1);
+  for(i=0;i<pp->n;i++){
+    c = pp->cov[i];
+    mask[i] = c < minCov || c > maxCov;
+    if(mask[i])
+      pp->num[i] = 0;
+  }
+  return mask;
+}
@@ -5,14 +5,41 @@
  **************************************************/
 #ifndef PROFILE
 #define PROFILE
+#include "types.h"
 
 typedef struct profile{  /* profile written to disk: */
   int profile[4];        /* profile */
-  int n;                 /* number of occurrences */
+  CountInt n;            /* number of occurrences */
 }Profile;
 
+typedef struct profile32{ /* profile in the 32-bit format */
+  int32_t profile[4];
+  int32_t n;
+}Profile32;
+
+#define PACK_WIDE UINT16_MAX /* profiles of this coverage or more are wide */
+
+typedef struct packedProfiles{ /* profiles stored by column: */
+  int n;                 /* number of profiles */
+  uint16_t *count[4];    /* allele counts, 0 in wide profiles */
+  int *cov;              /* coverage */
+  int64_t *num;          /* number of occurrences */
+  int numWide;           /* number of wide profiles */
+  int *wideId;           /* indexes of the wide profiles, ascending */
+  int *wideCount;        /* four allele counts per wide profile */
+}PackedProfiles;
+
 void readProfiles(char *baseName);
-Profile *getProfiles();
+Profile *loadProfiles(char *baseName, int *num);
+void writeProfiles(char *baseName, Profile *profiles, int numProfiles, int pack);
+PackedProfiles *getPackedProfiles();
 int getNumProfiles();
+void setPackedProfiles(PackedProfiles *pp);
+void setNumProfiles(int numProfiles);
+PackedProfiles *packProfiles(Profile *profiles, int numProfiles);
+void unpackProfile(PackedProfiles *pp, int i, int *profile);
+int *wideProfile(PackedProfiles *pp, int i);
+void freePackedProfiles(PackedProfiles *pp);
+char *coverageMask(PackedProfiles *pp, int minCov, int maxCov);
 
 #endif
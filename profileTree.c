@@ -16,79 +16,196 @@
 #include "interface.h"
 #include "profileTree.h"
 #include "ld.h"
+#include "reader.h"
+#include "trace.h"
 
 double numPos;
-Node **resetProfilePairs(Node **profilePairs, int numProfiles);
-Node **countPairs(Node **pairs, int numProfiles, ContigDescr *contigDescr, FILE *fp, int dist);
-
-Node **getProfilePairs(int numProfiles, ContigDescr *contigDescr, FILE *fp, Args *args, int d){
-  static Node **profilePairs = NULL;
+ProfilePairs *getJointProfilePairs(int numProfiles, ContigDescr *contigDescr, FILE *fp, Args *args, int d);
+ProfilePairs *resetProfilePairs(ProfilePairs *pp, int numProfiles, Args *args);
+void countPairs(ProfilePairs *pp, ContigDescr *contigDescr, FILE *fp, int dist);
+void addPairCount(ProfilePairs *pp, int a, int b);
+void compactDense(ProfilePairs *pp);
+
+ProfilePairs *getProfilePairs(int numProfiles, ContigDescr *contigDescr, FILE *fp, Args *args, int d){
+  static ProfilePairs *profilePairs = NULL;
   int i;
 
+  if(args->J > 1)
+    return getJointProfilePairs(numProfiles, contigDescr, fp, args, d);
   numPos = 0;
-  profilePairs = resetProfilePairs(profilePairs,numProfiles);
+  profilePairs = resetProfilePairs(profilePairs,numProfiles,args);
   if(args->L){
     for(i=0;i<args->S;i++)
-      profilePairs = countPairs(profilePairs, numProfiles, contigDescr, fp, d+i);
+      countPairs(profilePairs, contigDescr, fp, d+i);
   }else
-    profilePairs = countPairs(profilePairs, numProfiles, contigDescr, fp, d);
+    countPairs(profilePairs, contigDescr, fp, d);
+  if(profilePairs->dense)
+    compactDense(profilePairs);
+  else if(profilePairs->sp)
+    spillFinish(profilePairs->sp);
 
   return profilePairs;
 }
 
-Node **resetProfilePairs(Node **profilePairs, int numProfiles){
+/* getJointProfilePairs: pair counts at distance d taken from a 
+ * block of args->J distances counted together; the block starting
+ * at d is counted when d lies outside the current one 
+ */
+ProfilePairs *getJointProfilePairs(int numProfiles, ContigDescr *contigDescr, FILE *fp, Args *args, int d){
+  static ProfilePairs *pp = NULL;
+  JointPairs *jp;
+  int numDist;
+
+  if(args->L)
+    eprintf("joint counting of distances cannot be combined with -L.");
+  if(pp == NULL){
+    pp = (ProfilePairs *)emalloc(sizeof(ProfilePairs));
+    pp->numProfiles = numProfiles;
+    pp->trees = NULL;
+    pp->dense = NULL;
+    pp->pt = NULL;
+    pp->sp = NULL;
+    pp->jp = NULL;
+  }
+  jp = pp->jp;
+  if(jp == NULL || d < jp->first || d >= jp->first + jp->numDist*jp->step){
+    freeJointPairs(jp);
+    numDist = (args->M - d) / args->S + 1;
+    if(numDist > args->J)
+      numDist = args->J;
+    pp->jp = jp = countJointPairs(contigDescr, fp, d, args->S, numDist);
+  }
+  pp->col = (d - jp->first) / jp->step;
+  pp->numCol = 1;
+  numPos = jp->numPos[pp->col];
+
+  return pp;
+}
+
+/* resetProfilePairs: allocate pair counts on the first call, clear
+ * them on subsequent calls; the counts are dense if the triangle 
+ * of numProfiles x numProfiles counts fits into args->k MB and the
+ * memory limit args->G; they are spilled to disk if the triangle 
+ * exceeds the memory limit, and sparse otherwise
+ */
+ProfilePairs *resetProfilePairs(ProfilePairs *pp, int numProfiles, Args *args){
+  size_t mem;
   int i;
 
-  if(profilePairs == NULL){
-    profilePairs = (Node **)emalloc(numProfiles * sizeof(Node *));
-    for(i=0;i<numProfiles;i++)
-      profilePairs[i] = NULL;
-  }else{
+  if(pp == NULL){
+    pp = (ProfilePairs *)emalloc(sizeof(ProfilePairs));
+    pp->numProfiles = numProfiles;
+    pp->trees = NULL;
+    pp->dense = NULL;
+    pp->pt = NULL;
+    pp->sp = NULL;
+    pp->jp = NULL;
+    mem = (size_t)args->k << 20;
+    if(args->G > 0 && args->G < args->k)
+      mem = (size_t)args->G << 20;
+    if(TRI(numProfiles)*sizeof(CountInt) <= mem){
+      pp->dense = (CountInt *)calloc(TRI(numProfiles)+1,sizeof(CountInt));
+      if(pp->dense == NULL)
+	eprintf("calloc of dense pair counts failed:");
+      pp->pt = newPairTable();
+    }else if(args->G > 0)
+      pp->sp = newSpill((size_t)args->G << 20);
+    else{
+      pp->trees = (Node **)emalloc(numProfiles * sizeof(Node *));
+      for(i=0;i<numProfiles;i++)
+	pp->trees[i] = NULL;
+    }
+  }else if(pp->dense)
+    pp->pt->n = 0;  /* dense counts were zeroed by compactDense */
+  else if(pp->sp)
+    resetSpill(pp->sp);
+  else{
     for(i=0;i<numProfiles;i++){
-      freeTree(profilePairs[i]);
-      profilePairs[i] = NULL;
+      freeTree(pp->trees[i]);
+      pp->trees[i] = NULL;
     }
   }
-  return profilePairs;
+  return pp;
 }
 
-Node **countPairs(Node **pairs, int numProfiles, ContigDescr *contigDescr, FILE *fp, int dist){
-  int a, b, i, j, l, r, tmp, numRead;
+/* countPairs: count the pairs of sites dist apart; the pairs of
+ * each chunk of left sites are found by scanPairs, which has at
+ * most one partner per left site 
+ */
+void countPairs(ProfilePairs *pp, ContigDescr *contigDescr, FILE *fp, int dist){
+  int i, j, n, lo, hi, len;
+  uint64_t *keys;
   Position *pb;
+  ContigReader *cr;
   
-  pb = contigDescr->posBuf;
-  fseek(fp,3,SEEK_SET);
+  keys = (uint64_t *)emalloc(SCAN_CHUNK*sizeof(uint64_t));
+  cr = openContigReader(contigDescr, fp);
   for(i=0;i<contigDescr->n;i++){
-    for(j=0;j<contigDescr->len[i];j++){
-      numRead = fread(&pb[j],sizeof(Position),1,fp);
-      assert(numRead == 1);
+    pb = nextContig(cr, &len);
+    traceBegin("countPairs", i);
+    for(lo=0;lo<len;lo=hi){
+      hi = len - lo > SCAN_CHUNK ? lo + SCAN_CHUNK : len;
+      n = scanPairs(pb, len, lo, hi, dist, keys);
+      for(j=0;j<n;j++)
+	addPairCount(pp, KEY_A(keys[j]), KEY_B(keys[j]));
     }
-    l = 0;
-    r = 0;
-    while(r<contigDescr->len[i]){
-      while(pb[r].pos - pb[l].pos < dist && r<contigDescr->len[i])
-	r++;
-      while(pb[r].pos - pb[l].pos > dist && l<=r)
-  	l++;
-      if(pb[r].pos-pb[l].pos == dist){
-	a = pb[l].pro;
-	b = pb[r].pro;
-	if(a > b){ /* sort indexes to halve the number of index pairs */
-	  tmp = b;
-	  b = a;
-	  a = tmp;
-	}
-	pairs[b] = addTree(pairs[b],a);
-	numPos++;
+    traceEnd();
+  }
+  closeContigReader(cr);
+  free(keys);
+}
+
+/* addPairCount: count the pair of profiles a and b */
+void addPairCount(ProfilePairs *pp, int a, int b){
+  int tmp;
+
+  if(a > b){ /* sort indexes to halve the number of index pairs */
+    tmp = b;
+    b = a;
+    a = tmp;
+  }
+  if(pp->dense)
+    pp->dense[TRI(b)+a]++;
+  else if(pp->sp)
+    spillAdd(pp->sp, PAIR_KEY(a,b));
+  else
+    pp->trees[b] = addTree(pp->trees[b],a);
+  numPos++;
+}
+
+/* compactDense: move the non-zero dense counts into the pair table 
+ * and zero them for the next distance 
+ */
+void compactDense(ProfilePairs *pp){
+  int a, b;
+  CountInt *row;
+
+  for(b=0;b<pp->numProfiles;b++){
+    row = pp->dense + TRI(b);
+    for(a=0;a<=b;a++)
+      if(row[a]){
+	addPair(pp->pt, a, b, row[a]);
+	row[a] = 0;
       }
-      r++;
-      l++;
-    }
   }
-  return pairs;
 }
 
+void freeProfilePairs(ProfilePairs *pp){
+  int i;
 
+  if(pp == NULL)
+    return;
+  if(pp->trees){
+    for(i=0;i<pp->numProfiles;i++)
+      freeTree(pp->trees[i]);
+    free(pp->trees);
+  }
+  free(pp->dense);
+  freePairTable(pp->pt);
+  freeSpill(pp->sp);
+  freeJointPairs(pp->jp);
+  free(pp);
+}
 
 /* addTree: add key to tree */
 Node *addTree(Node *node, int key){
@@ -9,15 +9,33 @@
 #include <stdio.h>
 #include "interface.h"
 #include "ld.h"
+#include "pairTable.h"
+#include "spill.h"
+#include "joint.h"
+
+#define TRI(b) ((size_t)(b)*((b)+1)/2) /* first dense count of larger index b */
+#define SCAN_CHUNK 65536 /* left sites per call of scanPairs in countPairs */
 
 typedef struct node{  /* the tree node: */
   int key;            /* sort key */
-  int n;              /* number of occurrences */
+  CountInt n;         /* number of occurrences */
   struct node *left;  /* left child */
   struct node *right; /* right child */
 }Node;
 
-Node **getProfilePairs(int numProfiles, ContigDescr *contigDescr, FILE *fp, Args *args, int d);
+typedef struct profilePairs{ /* counts of profile pairs: */
+  int numProfiles;           /* number of profiles */
+  Node **trees;              /* sparse counts, one tree per larger index; or NULL */
+  CountInt *dense;           /* dense counts, triangle stored by larger index; or NULL */
+  PairTable *pt;             /* non-zero dense counts */
+  Spill *sp;                 /* counts under a memory limit; or NULL */
+  JointPairs *jp;            /* counts of a block of distances; or NULL */
+  int col;                   /* distance in jp */
+  int numCol;                /* number of distances from col on pooled */
+}ProfilePairs;
+
+ProfilePairs *getProfilePairs(int numProfiles, ContigDescr *contigDescr, FILE *fp, Args *args, int d);
+void freeProfilePairs(ProfilePairs *pp);
 void printTree(FILE *fp, Node *node);
 void freeTree(Node *n);
 void setTestMode();
@@ -0,0 +1,153 @@
+/***** reader.c ***********************************
+ * Description: Read contigs from the position file
+ *   in a separate thread. While the caller scans 
+ *   contig i in one buffer, contig i+1 is read 
+ *   into the other, which overlaps I/O with pair 
+ *   counting.
+ * License: GNU General Public
+ **************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "eprintf.h"
+#include "interface.h"
+#include "ld.h"
+#include "reader.h"
+
+void *readContigs(void *arg);
+int filterContig(int contig, Position *pb, int len);
+
+double sampleFrac = 1.;       /* fraction of sites delivered */
+unsigned int sampleSeed = 0;  /* seed of site selection */
+char *siteMask = NULL;        /* sites of profiles with mask set are dropped; or NULL */
+
+/* openContigReader: rewind the position file and start reading 
+ * contigs in the background 
+ */
+ContigReader *openContigReader(ContigDescr *cd, FILE *fp){
+  ContigReader *cr;
+
+  cr = (ContigReader *)emalloc(sizeof(ContigReader));
+  cr->fp = fp;
+  cr->cd = cd;
+  cr->buf[0] = cd->posBuf;
+  cr->buf[1] = cd->nextBuf;
+  cr->full[0] = cr->full[1] = 0;
+  cr->next = 0;
+  cr->stop = 0;
+  pthread_mutex_init(&cr->lock, NULL);
+  pthread_cond_init(&cr->cond, NULL);
+  fseek(fp,3,SEEK_SET);
+  if(pthread_create(&cr->thread, NULL, readContigs, cr))
+    eprintf("could not create reader thread");
+
+  return cr;
+}
+
+/* readContigs: reader thread; fill the buffers in turn as they
+ * are released by the caller 
+ */
+void *readContigs(void *arg){
+  ContigReader *cr;
+  int i, b;
+
+  cr = (ContigReader *)arg;
+  for(i=0;i<cr->cd->n;i++){
+    b = i % 2;
+    pthread_mutex_lock(&cr->lock);
+    while(cr->full[b] && !cr->stop)
+      pthread_cond_wait(&cr->cond, &cr->lock);
+    pthread_mutex_unlock(&cr->lock);
+    if(cr->stop)
+      break;
+    readContig(cr->fp, cr->buf[b], cr->cd->len[i], cr->cd->wide);
+    cr->len[b] = cr->cd->len[i];
+    if(sampleFrac < 1. || siteMask)
+      cr->len[b] = filterContig(i, cr->buf[b], cr->len[b]);
+    pthread_mutex_lock(&cr->lock);
+    cr->full[b] = 1;
+    pthread_cond_broadcast(&cr->cond);
+    pthread_mutex_unlock(&cr->lock);
+  }
+  return NULL;
+}
+
+/* nextContig: release the previous contig and return the next 
+ * one, waiting for it if necessary; its number of sites is 
+ * written to len 
+ */
+Position *nextContig(ContigReader *cr, int *len){
+  int b;
+
+  pthread_mutex_lock(&cr->lock);
+  if(cr->next > 0){
+    cr->full[(cr->next-1) % 2] = 0;
+    pthread_cond_broadcast(&cr->cond);
+  }
+  b = cr->next % 2;
+  while(!cr->full[b])
+    pthread_cond_wait(&cr->cond, &cr->lock);
+  cr->next++;
+  *len = cr->len[b];
+  pthread_mutex_unlock(&cr->lock);
+
+  return cr->buf[b];
+}
+
+void closeContigReader(ContigReader *cr){
+  pthread_mutex_lock(&cr->lock);
+  cr->stop = 1;
+  pthread_cond_broadcast(&cr->cond);
+  pthread_mutex_unlock(&cr->lock);
+  pthread_join(cr->thread, NULL);
+  pthread_mutex_destroy(&cr->lock);
+  pthread_cond_destroy(&cr->cond);
+  free(cr);
+}
+
+/* setSample: deliver only a fraction of the sites from now on; 
+ * which sites are kept depends only on the seed 
+ */
+void setSample(double fraction, unsigned long seed){
+  sampleFrac = fraction;
+  sampleSeed = (unsigned int)seed;
+}
+
+/* keepSite: is the site at pos on contig in the sample? The site
+ * is hashed with the seed by the finalizer of MurmurHash3 
+ */
+int keepSite(int contig, PosInt pos){
+  uint32_t h;
+
+  h = sampleSeed * 2654435761u;
+  h ^= (uint32_t)contig * 2246822519u;
+  h ^= (uint32_t)pos;
+  h ^= (uint32_t)((uint64_t)pos >> 32) * 3266489917u;
+  h ^= h >> 16;
+  h *= 0x85ebca6bu;
+  h ^= h >> 13;
+  h *= 0xc2b2ae35u;
+  h ^= h >> 16;
+  return h < sampleFrac * 4294967296.;
+}
+
+/* setMask: drop the sites whose profile p has mask[p] set from now
+ * on; NULL keeps all sites 
+ */
+void setMask(char *mask){
+  siteMask = mask;
+}
+
+/* filterContig: remove the sites masked or not in the sample and 
+ * return the number left 
+ */
+int filterContig(int contig, Position *pb, int len){
+  int i, n;
+
+  n = 0;
+  for(i=0;i<len;i++)
+    if((siteMask == NULL || !siteMask[pb[i].pro]) && 
+       (sampleFrac >= 1. || keepSite(contig, pb[i].pos)))
+      pb[n++] = pb[i];
+  return n;
+}
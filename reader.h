@@ -0,0 +1,31 @@
+/***** reader.h ***********************************
+ * Description: Header file for reader.c.
+ * License: GNU General Public
+ **************************************************/
+#ifndef READER
+#define READER
+#include <stdio.h>
+#include <pthread.h>
+#include "interface.h"
+#include "ld.h"
+
+typedef struct contigReader{ /* reads contigs ahead of their use: */
+  FILE *fp;                  /* position file */
+  ContigDescr *cd;           /* contig lengths and buffers */
+  Position *buf[2];          /* contig i is read into buf[i%2] */
+  int full[2];               /* buffer holds a contig not yet released */
+  int len[2];                /* number of sites in buffer */
+  int next;                  /* next contig handed to the caller */
+  int stop;                  /* caller closed the reader early */
+  pthread_t thread;
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+}ContigReader;
+
+ContigReader *openContigReader(ContigDescr *cd, FILE *fp);
+Position *nextContig(ContigReader *cr, int *len);
+void setSample(double fraction, unsigned long seed);
+int keepSite(int contig, PosInt pos);
+void setMask(char *mask);
+void closeContigReader(ContigReader *cr);
+#endif
@@ -0,0 +1,207 @@
+/***** reduce.c ***********************************
+ * Description: Parallel sums of likelihood terms.
+ *   By default the n items are cut into blocks of
+ *   RED_BLOCK, independent of the number of 
+ *   threads; each block is summed in order and the
+ *   block sums are added pairwise in a fixed tree,
+ *   so the result is the same bit for bit for any
+ *   number of threads. The unordered reduction 
+ *   gives each thread one contiguous range and adds
+ *   the thread sums; it is faster, but its result 
+ *   depends on the number of threads.
+ *   The worker threads are started once by 
+ *   iniReduce and wait for jobs between calls;
+ *   jobs are posted from the main thread only.
+ * License: GNU General Public
+ **************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "eprintf.h"
+#include "reduce.h"
+
+typedef struct redJob{ /* ranges summed by the pool: */
+  RangeSum f;          /* range function */
+  void *data;          /* its data */
+  size_t n;            /* number of items */
+  int k;               /* number of sums */
+  int numBlocks;       /* number of ranges */
+  size_t blockLen;     /* items per range */
+  double *sums;        /* k sums per range; or NULL */
+}RedJob;
+
+int redThreads = 1;
+int redUnordered = 0;
+/* the pool */
+pthread_t *pool = NULL;
+int *poolIds = NULL;
+pthread_mutex_t poolLock = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t poolStart = PTHREAD_COND_INITIALIZER;
+pthread_cond_t poolDone = PTHREAD_COND_INITIALIZER;
+unsigned long poolGen = 0; /* number of jobs posted */
+int poolPending = 0;       /* workers busy with the current job */
+int poolStop = 0;
+RedJob poolJob;
+
+void *poolWorker(void *arg);
+void runJob(RedJob *job);
+void sumRanges(RedJob *job, int first, int step);
+double pairwise(double *x, int n, int stride);
+
+/* iniReduce: start the pool of numThreads-1 worker threads, 
+ * which, with the main thread, compute the sums 
+ */
+void iniReduce(int numThreads, int unordered){
+  int i;
+
+  freeReduce();
+  redThreads = numThreads > 0 ? numThreads : 1;
+  redUnordered = unordered;
+  if(redThreads == 1)
+    return;
+  poolStop = 0;
+  pool = (pthread_t *)emalloc(redThreads*sizeof(pthread_t));
+  poolIds = (int *)emalloc(redThreads*sizeof(int));
+  for(i=1;i<redThreads;i++){
+    poolIds[i] = i;
+    if(pthread_create(&pool[i],NULL,poolWorker,&poolIds[i]))
+      eprintf("pthread_create failed:");
+  }
+}
+
+/* freeReduce: stop the pool */
+void freeReduce(){
+  int i;
+
+  if(pool == NULL)
+    return;
+  pthread_mutex_lock(&poolLock);
+  poolStop = 1;
+  pthread_cond_broadcast(&poolStart);
+  pthread_mutex_unlock(&poolLock);
+  for(i=1;i<redThreads;i++)
+    pthread_join(pool[i],NULL);
+  free(pool);
+  free(poolIds);
+  pool = NULL;
+  poolIds = NULL;
+}
+
+/* reduceSum: add the k sums of f over items 0,...,n-1 to l */
+void reduceSum(size_t n, int k, RangeSum f, void *data, double *l){
+  RedJob job;
+  int j;
+
+  if(n == 0)
+    return;
+  job.f = f;
+  job.data = data;
+  job.n = n;
+  job.k = k;
+  if(redUnordered){
+    job.numBlocks = n < (size_t)redThreads ? (int)n : redThreads;
+    job.blockLen = (n + job.numBlocks - 1) / job.numBlocks;
+  }else{
+    job.numBlocks = (n + RED_BLOCK - 1) / RED_BLOCK;
+    job.blockLen = RED_BLOCK;
+  }
+  job.sums = (double *)emalloc((size_t)job.numBlocks*k*sizeof(double));
+  runJob(&job);
+  for(j=0;j<k;j++)
+    l[j] += pairwise(job.sums+j, job.numBlocks, k);
+  free(job.sums);
+}
+
+/* parallelFor: apply f to items 0,...,n-1, which are independent */
+void parallelFor(size_t n, RangeSum f, void *data){
+  RedJob job;
+
+  if(n == 0)
+    return;
+  job.f = f;
+  job.data = data;
+  job.n = n;
+  job.k = 0;
+  job.numBlocks = (n + RED_BLOCK - 1) / RED_BLOCK;
+  job.blockLen = RED_BLOCK;
+  job.sums = NULL;
+  runJob(&job);
+}
+
+/* runJob: compute the ranges of job on the pool and the main 
+ * thread; a single range is computed directly 
+ */
+void runJob(RedJob *job){
+  if(pool == NULL || job->numBlocks == 1){
+    sumRanges(job, 0, 1);
+    return;
+  }
+  pthread_mutex_lock(&poolLock);
+  poolJob = *job;
+  poolPending = redThreads - 1;
+  poolGen++;
+  pthread_cond_broadcast(&poolStart);
+  pthread_mutex_unlock(&poolLock);
+  sumRanges(job, 0, redThreads);
+  pthread_mutex_lock(&poolLock);
+  while(poolPending)
+    pthread_cond_wait(&poolDone, &poolLock);
+  pthread_mutex_unlock(&poolLock);
+}
+
+void *poolWorker(void *arg){
+  RedJob job;
+  unsigned long gen;
+  int id;
+
+  id = *(int *)arg;
+  gen = 0;
+  for(;;){
+    pthread_mutex_lock(&poolLock);
+    while(poolGen == gen && !poolStop)
+      pthread_cond_wait(&poolStart, &poolLock);
+    if(poolStop){
+      pthread_mutex_unlock(&poolLock);
+      return NULL;
+    }
+    gen = poolGen;
+    job = poolJob;
+    pthread_mutex_unlock(&poolLock);
+    sumRanges(&job, id, redThreads);
+    pthread_mutex_lock(&poolLock);
+    if(--poolPending == 0)
+      pthread_cond_signal(&poolDone);
+    pthread_mutex_unlock(&poolLock);
+  }
+}
+
+/* sumRanges: compute ranges first, first+step, ... of job */
+void sumRanges(RedJob *job, int first, int step){
+  double *sums;
+  size_t lo, hi;
+  int b, j;
+
+  sums = NULL;
+  for(b=first;b<job->numBlocks;b+=step){
+    if(job->sums){
+      sums = job->sums + (size_t)b*job->k;
+      for(j=0;j<job->k;j++)
+	sums[j] = 0.;
+    }
+    lo = (size_t)b * job->blockLen;
+    hi = lo + job->blockLen < job->n ? lo + job->blockLen : job->n;
+    job->f(lo, hi, job->data, sums);
+  }
+}
+
+/* pairwise: sum of x[0], x[stride], ..., x[(n-1)*stride] by
+ * recursive halving 
+ */
+double pairwise(double *x, int n, int stride){
+  int m;
+
+  if(n == 1)
+    return x[0];
+  m = n / 2;
+  return pairwise(x, m, stride) + pairwise(x + (size_t)m*stride, n - m, stride);
+}
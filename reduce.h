@@ -0,0 +1,19 @@
+/***** reduce.h ***********************************
+ * Description: Header file for reduce.c.
+ * License: GNU General Public
+ **************************************************/
+#ifndef REDUCE
+#define REDUCE
+#include <stddef.h>
+
+#define RED_BLOCK 2048 /* items per block, a few pages of profiles or pairs */
+
+/* RangeSum: add the k sums over items lo,...,hi-1 to sums; sums
+ * is NULL in parallelFor */
+typedef void (*RangeSum)(size_t lo, size_t hi, void *data, double *sums);
+
+void iniReduce(int numThreads, int unordered);
+void reduceSum(size_t n, int k, RangeSum f, void *data, double *l);
+void parallelFor(size_t n, RangeSum f, void *data);
+void freeReduce();
+#endif
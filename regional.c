@@ -0,0 +1,315 @@
+/***** regional.c *********************************
+ * Description: Estimate theta and rho per contig or
+ *   per window of positions. Profile and pair counts
+ *   are kept per window during a single pass over
+ *   the positions; the windows are then fitted in 
+ *   parallel. Epsilon is fixed at its genome-wide
+ *   estimate.
+ * License: GNU General Public
+ **************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <float.h>
+#include <math.h>
+#include <limits.h>
+#include <assert.h>
+#include <pthread.h>
+#include "eprintf.h"
+#include "interface.h"
+#include "ld.h"
+#include "mlComp.h"
+#include "pairTable.h"
+#include "reader.h"
+#include "regional.h"
+
+#define MIN_KEYS (1 << 20)
+
+typedef struct fit{     /* window being fitted: */
+  Regions *reg;         /* all windows */
+  int w;                /* index of window */
+  double pi;            /* estimate of theta */
+}Fit;
+
+typedef struct regWorker{ /* thread fitting windows: */
+  Regions *reg;           /* windows */
+  Args *args;             /* arguments */
+  double pi;              /* genome-wide theta */
+  int first;              /* first window */
+  int step;               /* stride between windows */
+}RegWorker;
+
+Regions *countRegions(ContigDescr *contigDescr, FILE *fp, Args *args);
+void addWindow(Regions *reg, int contig, Position *pb, int len, int lo, int hi, 
+	       int *dists, int numDist, uint64_t *keys, int maxKeys, int *ids, Args *args);
+void *fitWindows(void *p);
+double thetaF(const gsl_vector *v, void *params);
+double deltaF(const gsl_vector *v, void *params);
+int cmpInt(const void *p1, const void *p2);
+void printRegions(Regions *reg, Args *args);
+void freeRegions(Regions *reg);
+
+/* runRegional: estimate theta, delta and rho in each window */
+void runRegional(ContigDescr *contigDescr, FILE *fp, Args *args, Result *result){
+  Regions *reg;
+  RegWorker *workers;
+  pthread_t *threads;
+  int i, numThreads;
+
+  if(args->M == INT_MAX)
+    eprintf("regional analysis needs a maximum distance; please use -M.");
+  if(getCoverages() == NULL)  /* likelihoods were read from file */
+    iniMlComp(getPackedProfiles(), getNumProfiles());
+  reg = countRegions(contigDescr, fp, args);
+  numThreads = args->c < reg->n ? args->c : reg->n;
+  workers = (RegWorker *)emalloc((numThreads+1)*sizeof(RegWorker));
+  threads = (pthread_t *)emalloc((numThreads+1)*sizeof(pthread_t));
+  for(i=0;i<numThreads;i++){
+    workers[i].reg = reg;
+    workers[i].args = args;
+    workers[i].pi = result->pi;
+    workers[i].first = i;
+    workers[i].step = numThreads;
+    if(pthread_create(&threads[i],NULL,fitWindows,&workers[i]))
+      eprintf("pthread_create failed:");
+  }
+  for(i=0;i<numThreads;i++)
+    pthread_join(threads[i],NULL);
+  printRegions(reg, args);
+  free(threads);
+  free(workers);
+  freeRegions(reg);
+}
+
+/* countRegions: read the positions once and count the profiles 
+ * and the pairs of profiles at distances m,...,M in each window; 
+ * windows of -w positions start at 1, 1+w, 1+2w, ...; a pair 
+ * belongs to the window of its left site
+ */
+Regions *countRegions(ContigDescr *contigDescr, FILE *fp, Args *args){
+  Regions *reg;
+  Position *pb;
+  ContigReader *cr;
+  uint64_t *keys;
+  int *dists, *ids;
+  int i, k, d, lo, hi, len, max, maxKeys, numDist;
+  PosInt win;
+
+  /* distances analyzed */
+  numDist = 0;
+  for(d=args->m;d<=args->M;d+=args->S)
+    numDist += args->L ? args->S : 1;
+  dists = (int *)emalloc((numDist+1)*sizeof(int));
+  k = 0;
+  for(d=args->m;d<=args->M;d+=args->S)
+    for(i=0;i<(args->L ? args->S : 1);i++)
+      dists[k++] = d + i;
+  max = 0;
+  for(i=0;i<contigDescr->n;i++)
+    if(contigDescr->len[i] > max)
+      max = contigDescr->len[i];
+  maxKeys = max > MIN_KEYS ? max : MIN_KEYS;
+  keys = (uint64_t *)emalloc(maxKeys*sizeof(uint64_t));
+  ids = (int *)emalloc((max+1)*sizeof(int));
+  reg = (Regions *)emalloc(sizeof(Regions));
+  reg->n = 0;
+  reg->max = 1024;
+  reg->win = (Window *)emalloc(reg->max*sizeof(Window));
+  reg->proStart = (int *)emalloc((reg->max+1)*sizeof(int));
+  reg->pairStart = (size_t *)emalloc((reg->max+1)*sizeof(size_t));
+  reg->numPro = 0;
+  reg->maxPro = 1024;
+  reg->proId = (int *)emalloc(reg->maxPro*sizeof(int));
+  reg->proN = (int *)emalloc(reg->maxPro*sizeof(int));
+  reg->pt = newPairTable();
+  cr = openContigReader(contigDescr, fp);
+  for(i=0;i<contigDescr->n;i++){
+    pb = nextContig(cr, &len);
+    for(lo=0;lo<len;lo=hi){
+      if(args->C)
+	hi = len;
+      else{
+	win = (pb[lo].pos - 1) / args->w;
+	for(hi=lo+1;hi<len && (pb[hi].pos - 1) / args->w == win;hi++)
+	  ;
+      }
+      addWindow(reg, i, pb, len, lo, hi, dists, numDist, keys, maxKeys, ids, args);
+    }
+  }
+  reg->proStart[reg->n] = reg->numPro;
+  reg->pairStart[reg->n] = reg->pt->n;
+  free(ids);
+  closeContigReader(cr);
+  free(keys);
+  free(dists);
+
+  return reg;
+}
+
+/* addWindow: count profiles at sites lo,...,hi-1 and the pairs 
+ * starting there 
+ */
+void addWindow(Regions *reg, int contig, Position *pb, int len, int lo, int hi, 
+	       int *dists, int numDist, uint64_t *keys, int maxKeys, int *ids, Args *args){
+  Window *w;
+  int i, j, n, numKeys;
+  double distSum;
+
+  if(reg->n == reg->max){
+    reg->max *= 2;
+    reg->win = (Window *)erealloc(reg->win,reg->max*sizeof(Window));
+    reg->proStart = (int *)erealloc(reg->proStart,(reg->max+1)*sizeof(int));
+    reg->pairStart = (size_t *)erealloc(reg->pairStart,(reg->max+1)*sizeof(size_t));
+  }
+  w = &reg->win[reg->n];
+  w->contig = contig;
+  w->numSites = hi - lo;
+  if(args->C){
+    w->start = pb[lo].pos;
+    w->end = pb[hi-1].pos;
+  }else{
+    w->start = (pb[lo].pos - 1) / args->w * args->w + 1;
+    w->end = w->start + args->w - 1;
+  }
+  /* profiles */
+  reg->proStart[reg->n] = reg->numPro;
+  for(i=lo;i<hi;i++)
+    ids[i-lo] = pb[i].pro;
+  qsort(ids,hi-lo,sizeof(int),cmpInt);
+  for(i=0;i<hi-lo;i=j){
+    for(j=i+1;j<hi-lo && ids[j]==ids[i];j++)
+      ;
+    if(reg->numPro == reg->maxPro){
+      reg->maxPro *= 2;
+      reg->proId = (int *)erealloc(reg->proId,reg->maxPro*sizeof(int));
+      reg->proN = (int *)erealloc(reg->proN,reg->maxPro*sizeof(int));
+    }
+    reg->proId[reg->numPro] = ids[i];
+    reg->proN[reg->numPro] = j - i;
+    reg->numPro++;
+  }
+  /* pairs */
+  reg->pairStart[reg->n] = reg->pt->n;
+  w->numPairs = 0;
+  distSum = 0;
+  numKeys = 0;
+  for(i=0;i<numDist;i++){
+    if(numKeys + hi - lo > maxKeys){
+      addPairKeys(reg->pt, keys, numKeys);
+      numKeys = 0;
+    }
+    n = scanPairs(pb, len, lo, hi, dists[i], keys+numKeys);
+    numKeys += n;
+    w->numPairs += n;
+    distSum += (double)n * dists[i];
+  }
+  addPairKeys(reg->pt, keys, numKeys);
+  w->dist = w->numPairs > 0 ? distSum / w->numPairs : 0;
+  reg->n++;
+}
+
+/* fitWindows: estimate theta, delta and rho in every step-th 
+ * window starting at first 
+ */
+void *fitWindows(void *p){
+  RegWorker *wo;
+  Window *w;
+  Fit fit;
+  int i;
+
+  wo = (RegWorker *)p;
+  fit.reg = wo->reg;
+  for(i=wo->first;i<wo->reg->n;i+=wo->step){
+    w = &wo->reg->win[i];
+    fit.w = i;
+    w->pi = minimizeOne(&thetaF, &fit, wo->pi, wo->args);
+    fit.pi = w->pi;
+    if(w->numPairs > 0){
+      w->de = minimizeOne(&deltaF, &fit, wo->args->D, wo->args);
+      w->rh = rhoFromDelta(w->pi, w->de) / w->dist;
+    }else
+      w->de = w->rh = NAN;
+  }
+  return NULL;
+}
+
+/* thetaF: negative log-likelihood of theta in a window given
+ * the site likelihoods at the genome-wide epsilon
+ */
+double thetaF(const gsl_vector *v, void *params){
+  Fit *fit;
+  Regions *reg;
+  double pi, l, li, *lOnes, *lTwos, *lScales;
+  int i, a;
+
+  pi = gsl_vector_get(v, 0);
+  if(pi < 0 || pi > 1)
+    return DBL_MAX;
+  fit = (Fit *)params;
+  reg = fit->reg;
+  lOnes = getLones();
+  lTwos = getLtwos();
+  lScales = getLscales();
+  l = 0.;
+  for(i=reg->proStart[fit->w];i<reg->proStart[fit->w+1];i++){
+    a = reg->proId[i];
+    li = lOnes[a] * (1.0 - pi) + lTwos[a] * pi;
+    if(li > 0)
+      l += (log(li) + lScales[a]) * reg->proN[i];
+  }
+  return -l;
+}
+
+/* deltaF: negative log-likelihood of delta in a window */
+double deltaF(const gsl_vector *v, void *params){
+  Fit *fit;
+  double de, h0, h2, complementHalf;
+
+  de = gsl_vector_get(v, 0);
+  if(de < -1 || de > 1)
+    return DBL_MAX;
+  fit = (Fit *)params;
+  compH(fit->pi, de, &h0, &h2, &complementHalf);
+  return -pairTableLik(fit->reg->pt, fit->reg->pairStart[fit->w], fit->reg->pairStart[fit->w+1], 
+		       getLones(), getLtwos(), getLscales(), h0, h2, complementHalf);
+}
+
+/* printRegions: print the window estimates and write them to 
+ * the recombination map if requested; windows are printed with 
+ * 1-based, closed coordinates, the map is a bedGraph with 0-based, 
+ * half-open ones
+ */
+void printRegions(Regions *reg, Args *args){
+  Window *w;
+  FILE *fp;
+  int i;
+
+  fp = NULL;
+  if(args->o)
+    fp = efopen(args->o,"w");
+  printf("contig\tstart\tend\tn\ttheta\t\tpairs\td\tdelta\t\trho\n");
+  for(i=0;i<reg->n;i++){
+    w = &reg->win[i];
+    printf("%d\t" POS_FMT "\t" POS_FMT "\t%d\t%8.2e\t%.0f\t%.1f\t%8.2e\t%8.2e\n",w->contig+1,w->start,w->end,
+	   w->numSites,w->pi,w->numPairs,w->dist,w->de,w->rh);
+    if(fp && !isnan(w->rh))
+      fprintf(fp,"Contig%d\t" POS_FMT "\t" POS_FMT "\t%g\n",w->contig+1,w->start-1,w->end,w->rh);
+  }
+  if(fp){
+    printf("#Recombination map written to %s\n",args->o);
+    fclose(fp);
+  }
+}
+
+int cmpInt(const void *p1, const void *p2){
+  return *(int *)p1 - *(int *)p2;
+}
+
+void freeRegions(Regions *reg){
+  freePairTable(reg->pt);
+  free(reg->win);
+  free(reg->proStart);
+  free(reg->proId);
+  free(reg->proN);
+  free(reg->pairStart);
+  free(reg);
+}
@@ -0,0 +1,40 @@
+/***** regional.h *********************************
+ * Description: Header file for regional.c.
+ * License: GNU General Public
+ **************************************************/
+#ifndef REGIONAL
+#define REGIONAL
+#include <stdio.h>
+#include "interface.h"
+#include "ld.h"
+#include "mlComp.h"
+#include "pairTable.h"
+
+typedef struct window{  /* region of a contig: */
+  int contig;           /* contig index */
+  PosInt start;         /* first position */
+  PosInt end;           /* last position */
+  int numSites;         /* number of sites */
+  double numPairs;      /* number of pairs */
+  double dist;          /* mean distance within pairs */
+  double pi;            /* estimate of theta */
+  double de;            /* estimate of delta */
+  double rh;            /* estimate of rho */
+}Window;
+
+typedef struct regions{ /* windows and their counts: */
+  int n;                /* number of windows */
+  int max;              /* number of windows allocated */
+  Window *win;          /* windows */
+  int *proStart;        /* first profile of each window; n+1 entries */
+  int *proId;           /* profile indexes */
+  int *proN;            /* profile counts */
+  int numPro;           /* length of proId and proN */
+  int maxPro;           /* number of profiles allocated */
+  size_t *pairStart;    /* first pair of each window in pt; n+1 entries */
+  PairTable *pt;        /* pairs, window by window */
+}Regions;
+
+void runRegional(ContigDescr *contigDescr, FILE *fp, Args *args, Result *result);
+
+#endif
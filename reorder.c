@@ -0,0 +1,98 @@
+/***** reorder.c **********************************
+ * Description: Renumber the profiles of a database
+ *   by descending frequency. The most frequent pro-
+ *   files then get the smallest indexes, so the site
+ *   likelihoods and pair counts touched most often
+ *   share cache lines.
+ * License: GNU General Public
+ **************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "eprintf.h"
+#include "interface.h"
+#include "profile.h"
+#include "ld.h"
+#include "mlComp.h"
+#include "reorder.h"
+
+#define CHUNK (1 << 16)
+
+Profile *sortProfiles;
+
+int cmpFreq(const void *p1, const void *p2);
+
+void reorderDb(Args *args){
+  Profile *profiles, *sorted;
+  Position *pb;
+  FILE *in, *out;
+  int *order, *rank;
+  int i, numProfiles, numRead, wide;
+  char *fileName, *tmpName;
+
+  profiles = loadProfiles(args->n, &numProfiles);
+  order = (int *)emalloc((numProfiles+1)*sizeof(int));
+  for(i=0;i<numProfiles;i++)
+    order[i] = i;
+  sortProfiles = profiles;
+  qsort(order,numProfiles,sizeof(int),cmpFreq);
+  for(i=0;i<numProfiles;i++)
+    if(order[i] != i)
+      break;
+  if(i == numProfiles){
+    free(order);
+    free(profiles);
+    return;
+  }
+  rank = (int *)emalloc((numProfiles+1)*sizeof(int));
+  sorted = (Profile *)emalloc((numProfiles+1)*sizeof(Profile));
+  for(i=0;i<numProfiles;i++){
+    rank[order[i]] = i;
+    sorted[i] = profiles[order[i]];
+  }
+  /* rewrite positions */
+  tmpName = (char *)emalloc(256*sizeof(char));
+  tmpName = strcpy(tmpName,args->n);
+  tmpName = strcat(tmpName,".tmp");
+  in = openPos(args->n, "rb", &wide);
+  out = openPos(tmpName, "wb", &wide);
+  pb = (Position *)emalloc(CHUNK*sizeof(Position));
+  while((numRead = readPositions(in, pb, CHUNK, wide)) > 0){
+    for(i=0;i<numRead;i++)
+      pb[i].pro = rank[pb[i].pro];
+    writePositions(out, pb, numRead, wide);
+  }
+  fclose(in);
+  fclose(out);
+  fileName = (char *)emalloc(256*sizeof(char));
+  fileName = strcpy(fileName,args->n);
+  fileName = strcat(fileName,".pos");
+  tmpName = strcat(tmpName,".pos");
+  if(rename(tmpName,fileName) != 0)
+    eprintf("rename(%s, %s) failed:",tmpName,fileName);
+  writeProfiles(args->n, sorted, numProfiles, args->Z);
+  printf("#Profiles of %s renumbered by frequency\n",args->n);
+  free(fileName);
+  free(tmpName);
+  free(pb);
+  free(sorted);
+  free(rank);
+  free(order);
+  free(profiles);
+}
+
+/* cmpFreq: order profile indexes by descending number of
+ * occurrences, ties by index 
+ */
+int cmpFreq(const void *p1, const void *p2){
+  int i1, i2;
+
+  i1 = *(int *)p1;
+  i2 = *(int *)p2;
+  if(sortProfiles[i1].n > sortProfiles[i2].n)
+    return -1;
+  else if(sortProfiles[i1].n < sortProfiles[i2].n)
+    return 1;
+  return i1 - i2;
+}
@@ -0,0 +1,11 @@
+/***** reorder.h **********************************
+ * Description: Header file for reorder.c.
+ * License: GNU General Public
+ **************************************************/
+#ifndef REORDER
+#define REORDER
+#include "interface.h"
+
+void reorderDb(Args *args);
+
+#endif
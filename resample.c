@@ -0,0 +1,307 @@
+/***** resample.c *********************************
+ * Description: Block-bootstrap and block-jackknife
+ *   confidence intervals of delta and rho. Pairs 
+ *   are counted once per block of sites; each re-
+ *   plicate then reweights the blocks instead of 
+ *   rereading the positions. Replicates are fitted
+ *   in parallel.
+ * License: GNU General Public
+ **************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <float.h>
+#include <math.h>
+#include <assert.h>
+#include <pthread.h>
+#include <gsl/gsl_errno.h>
+#include <gsl/gsl_rng.h>
+#include <gsl/gsl_randist.h>
+#include "eprintf.h"
+#include "interface.h"
+#include "ld.h"
+#include "mlComp.h"
+#include "pairTable.h"
+#include "reader.h"
+#include "resample.h"
+
+typedef struct replicate{  /* resampling replicate: */
+  BlockPairs *bp;          /* blocks of pairs */
+  double *w;               /* block weights */
+  double pi;               /* heterozygosity */
+  double de;               /* estimate of delta */
+}Replicate;
+
+typedef struct worker{     /* thread fitting replicates: */
+  BlockPairs *bp;          /* blocks of pairs */
+  Args *args;              /* arguments */
+  double pi;               /* heterozygosity */
+  double de;               /* starting value of delta */
+  double *des;             /* replicate estimates of delta */
+  int first;               /* first replicate */
+  int step;                /* stride between replicates */
+  int num;                 /* number of replicates */
+}Worker;
+
+void *runWorker(void *p);
+double fitReplicate(Replicate *rep, Args *args, double de);
+double repF(const gsl_vector *v, void *params);
+double repLik(Replicate *rep, double de);
+int cmpDouble(const void *p1, const void *p2);
+double quantile(double *x, int n, double q);
+void jackknife(double *x, int n, double est, double *lo, double *up);
+
+/* getBlockPairs: count the pairs of profiles d apart, or d,...,
+ * d+S-1 apart if distance classes are lumped, separately for 
+ * each block of sites; a block is a contig, or, if args->B is
+ * set, a run of args->B sites that may span contigs
+ */
+BlockPairs *getBlockPairs(ContigDescr *contigDescr, FILE *fp, Args *args, int d){
+  BlockPairs *bp;
+  Position *pb;
+  ContigReader *cr;
+  uint64_t *keys;
+  int i, k, lo, hi, len, max, fill, numDist, numKeys;
+  int maxBlocks;
+
+  numDist = args->L ? args->S : 1;
+  max = 0;
+  for(i=0;i<contigDescr->n;i++)
+    if(contigDescr->len[i] > max)
+      max = contigDescr->len[i];
+  keys = (uint64_t *)emalloc(((size_t)max*numDist+1)*sizeof(uint64_t));
+  bp = (BlockPairs *)emalloc(sizeof(BlockPairs));
+  bp->pt = newPairTable();
+  bp->n = 0;
+  maxBlocks = contigDescr->n + 1;
+  bp->start = (size_t *)emalloc((maxBlocks+1)*sizeof(size_t));
+  cr = openContigReader(contigDescr, fp);
+  fill = 0;
+  for(i=0;i<contigDescr->n;i++){
+    pb = nextContig(cr, &len);
+    lo = 0;
+    do{
+      /* open new block? */
+      if(bp->n == 0 || (args->B == 0 && lo == 0) || (args->B > 0 && fill == args->B)){
+	if(bp->n == maxBlocks){
+	  maxBlocks *= 2;
+	  bp->start = (size_t *)erealloc(bp->start,(maxBlocks+1)*sizeof(size_t));
+	}
+	bp->start[bp->n++] = bp->pt->n;
+	fill = 0;
+      }
+      hi = args->B > 0 && len - lo > args->B - fill ? lo + args->B - fill : len;
+      numKeys = 0;
+      for(k=0;k<numDist;k++)
+	numKeys += scanPairs(pb, len, lo, hi, d+k, keys+numKeys);
+      addPairKeys(bp->pt, keys, numKeys);
+      fill += hi - lo;
+      lo = hi;
+    }while(lo < len);
+  }
+  bp->start[bp->n] = bp->pt->n;
+  closeContigReader(cr);
+  free(keys);
+
+  return bp;
+}
+
+/* resampleDelta: replace the likelihood intervals of delta 
+ * and rho in result by block-bootstrap or block-jackknife 
+ * intervals
+ */
+void resampleDelta(ContigDescr *contigDescr, FILE *fp, Args *args, Result *result, int dist){
+  BlockPairs *bp;
+  Worker *workers;
+  pthread_t *threads;
+  double *des, *rhs;
+  int i, numRep, numThreads, numRh;
+
+  bp = getBlockPairs(contigDescr, fp, args, dist);
+  if(bp->n < 2){
+    printf("WARNING: Block-%s needs at least two blocks; found %d.\n",args->j ? "jackknife" : "bootstrap",bp->n);
+    result->dLo = result->dUp = result->de;
+    result->rLo = result->rUp = result->rh;
+    freeBlockPairs(bp);
+    return;
+  }
+  numRep = args->j ? bp->n : args->b;
+  des = (double *)emalloc(numRep*sizeof(double));
+  rhs = (double *)emalloc(numRep*sizeof(double));
+  numThreads = args->c < numRep ? args->c : numRep;
+  workers = (Worker *)emalloc(numThreads*sizeof(Worker));
+  threads = (pthread_t *)emalloc(numThreads*sizeof(pthread_t));
+  for(i=0;i<numThreads;i++){
+    workers[i].bp = bp;
+    workers[i].args = args;
+    workers[i].pi = result->pi;
+    workers[i].de = result->de;
+    workers[i].des = des;
+    workers[i].first = i;
+    workers[i].step = numThreads;
+    workers[i].num = numRep;
+    if(pthread_create(&threads[i],NULL,runWorker,&workers[i]))
+      eprintf("pthread_create failed:");
+  }
+  for(i=0;i<numThreads;i++)
+    pthread_join(threads[i],NULL);
+  numRh = 0;
+  for(i=0;i<numRep;i++){
+    rhs[i] = rhoFromDelta(result->pi,des[i])/dist;
+    if(!isnan(rhs[i]))
+      numRh++;
+  }
+  if(args->j){
+    jackknife(des, numRep, result->de, &result->dLo, &result->dUp);
+    jackknife(rhs, numRep, result->rh, &result->rLo, &result->rUp);
+  }else{
+    qsort(des,numRep,sizeof(double),cmpDouble);
+    qsort(rhs,numRep,sizeof(double),cmpDouble); /* NaNs sort last */
+    result->dLo = quantile(des, numRep, 0.025);
+    result->dUp = quantile(des, numRep, 0.975);
+    result->rLo = quantile(rhs, numRh, 0.025);
+    result->rUp = quantile(rhs, numRh, 0.975);
+  }
+  free(threads);
+  free(workers);
+  free(rhs);
+  free(des);
+  freeBlockPairs(bp);
+}
+
+/* runWorker: fit every step-th replicate starting at first */
+void *runWorker(void *p){
+  Worker *wo;
+  Replicate rep;
+  gsl_rng *rng;
+  unsigned int *counts;
+  double *prob;
+  int i, j, numBlocks;
+
+  wo = (Worker *)p;
+  numBlocks = wo->bp->n;
+  rep.bp = wo->bp;
+  rep.pi = wo->pi;
+  rep.w = (double *)emalloc(numBlocks*sizeof(double));
+  counts = (unsigned int *)emalloc(numBlocks*sizeof(unsigned int));
+  prob = (double *)emalloc(numBlocks*sizeof(double));
+  for(j=0;j<numBlocks;j++)
+    prob[j] = 1.;
+  rng = gsl_rng_alloc(gsl_rng_taus);
+  for(i=wo->first;i<wo->num;i+=wo->step){
+    if(wo->args->j){  /* leave out block i */
+      for(j=0;j<numBlocks;j++)
+	rep.w[j] = 1.;
+      rep.w[i] = 0.;
+    }else{            /* draw blocks with replacement */
+      gsl_rng_set(rng, wo->args->z + i);
+      gsl_ran_multinomial(rng, numBlocks, numBlocks, prob, counts);
+      for(j=0;j<numBlocks;j++)
+	rep.w[j] = counts[j];
+    }
+    wo->des[i] = fitReplicate(&rep, wo->args, wo->de);
+  }
+  gsl_rng_free(rng);
+  free(prob);
+  free(counts);
+  free(rep.w);
+  return NULL;
+}
+
+/* fitReplicate: estimate delta for a replicate */
+double fitReplicate(Replicate *rep, Args *args, double de){
+  return minimizeOne(&repF, rep, de, args);
+}
+
+double repF(const gsl_vector *v, void *params){
+  double de;
+
+  de = gsl_vector_get(v, 0);
+  if(de < -1 || de > 1)
+    return DBL_MAX;
+  return -repLik((Replicate *)params, de);
+}
+
+/* repLik: log-likelihood of delta summed over the weighted blocks */
+double repLik(Replicate *rep, double de){
+  BlockPairs *bp;
+  double h0, h2, complementHalf, l;
+  double *lOnes, *lTwos;
+  int i;
+
+  bp = rep->bp;
+  lOnes = getLones();
+  lTwos = getLtwos();
+  compH(rep->pi, de, &h0, &h2, &complementHalf);
+  l = 0.;
+  for(i=0;i<bp->n;i++)
+    if(rep->w[i] > 0)
+      l += rep->w[i] * pairTableLik(bp->pt, bp->start[i], bp->start[i+1], 
+				    lOnes, lTwos, getLscales(), h0, h2, complementHalf);
+  return l;
+}
+
+/* jackknife: interval of two standard errors around est 
+ * from n leave-one-out estimates x
+ */
+void jackknife(double *x, int n, double est, double *lo, double *up){
+  int i, m;
+  double mean, v;
+
+  mean = 0.;
+  m = 0;
+  for(i=0;i<n;i++)
+    if(!isnan(x[i])){
+      mean += x[i];
+      m++;
+    }
+  if(m < 2){
+    *lo = *up = est;
+    return;
+  }
+  mean /= m;
+  v = 0.;
+  for(i=0;i<n;i++)
+    if(!isnan(x[i]))
+      v += (x[i]-mean)*(x[i]-mean);
+  v *= (m-1.)/m;
+  *lo = est - 2.*sqrt(v);
+  *up = est + 2.*sqrt(v);
+}
+
+/* quantile: q-quantile of the sorted array x of length n */
+double quantile(double *x, int n, double q){
+  double h;
+  int i;
+
+  if(n == 0)
+    return NAN;
+  h = q*(n-1);
+  i = (int)h;
+  if(i+1 < n)
+    return x[i] + (h-i)*(x[i+1]-x[i]);
+  return x[i];
+}
+
+int cmpDouble(const void *p1, const void *p2){
+  double x1, x2;
+
+  x1 = *(double *)p1;
+  x2 = *(double *)p2;
+  if(isnan(x1))
+    return isnan(x2) ? 0 : 1;
+  if(isnan(x2))
+    return -1;
+  if(x1 < x2)
+    return -1;
+  else if(x1 > x2)
+    return 1;
+  return 0;
+}
+
+void freeBlockPairs(BlockPairs *bp){
+  if(bp){
+    freePairTable(bp->pt);
+    free(bp->start);
+    free(bp);
+  }
+}
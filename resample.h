@@ -0,0 +1,23 @@
+/***** resample.h *********************************
+ * Description: Header file for resample.c.
+ * License: GNU General Public
+ **************************************************/
+#ifndef RESAMPLE
+#define RESAMPLE
+#include <stdio.h>
+#include "interface.h"
+#include "ld.h"
+#include "mlComp.h"
+#include "pairTable.h"
+
+typedef struct blockPairs{ /* profile pairs split into blocks of sites: */
+  int n;                   /* number of blocks */
+  size_t *start;           /* first pair of each block in pt; n+1 entries */
+  PairTable *pt;           /* pairs, block by block */
+}BlockPairs;
+
+BlockPairs *getBlockPairs(ContigDescr *contigDescr, FILE *fp, Args *args, int d);
+void resampleDelta(ContigDescr *contigDescr, FILE *fp, Args *args, Result *result, int dist);
+void freeBlockPairs(BlockPairs *bp);
+
+#endif
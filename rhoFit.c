@@ -0,0 +1,214 @@
+/***** rhoFit.c ***********************************
+ * Description: Joint fit of rho over all dis-
+ *   tances. The pairs at distances m, m+S, ..., M 
+ *   are counted in a single pass, and a single 
+ *   rho, or rho(d) = rho*(d/m)^b, is estimated by
+ *   maximizing the composite likelihood summed 
+ *   over the distances. Delta at distance d is 
+ *   the value whose conversion by rhoFromDelta 
+ *   gives rho(d)*d.
+ * License: GNU General Public
+ **************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <gsl/gsl_errno.h>
+#include <gsl/gsl_roots.h>
+#include "eprintf.h"
+#include "interface.h"
+#include "ld.h"
+#include "profile.h"
+#include "mlComp.h"
+#include "joint.h"
+#include "trace.h"
+#include "rhoFit.h"
+
+typedef struct rhoModel{ /* state of the joint fit: */
+  JointPairs *jp;
+  double pi;
+  double b;              /* exponent of rho(d) */
+  double l;              /* -log(L) at the estimate */
+  double *h0, *h2, *complementHalf; /* pair probabilities by distance */
+}RhoModel;
+
+double rhoLik(RhoModel *rm, double rho, double b);
+double myRho(const gsl_vector *v, void *params);
+double rhoConfFun(double x, void *params);
+void confRho(Args *args, RhoModel *rm, Result *result);
+double rootRho(Args *args, gsl_root_fsolver *s, double xLo, double xHi);
+
+/* runRhoFit: count the pairs at distances m, m+S, ..., M together 
+ * and fit rho jointly; getArgs has checked the options 
+ */
+void runRhoFit(ContigDescr *contigDescr, FILE *fp, Args *args, Result *result){
+  JointPairs *jp;
+  int numDist;
+
+  numDist = (args->M - args->m) / args->S + 1;
+  if(numDist < 1)
+    return;
+  jp = countJointPairs(contigDescr, fp, args->m, args->S, numDist);
+  fitRho(jp, args, result);
+  freeJointPairs(jp);
+}
+
+/* fitRho: estimate rho, and the exponent b of rho(d) if args->Q is
+ * RHO_POWER, from the pairs in jp using the Nelder-Mead Simplex 
+ * algorithm on log(rho) 
+ */
+void fitRho(JointPairs *jp, Args *args, Result *result){
+  const gsl_multimin_fminimizer_type *T;
+  gsl_multimin_fminimizer *s;
+  gsl_multimin_function minex_func;
+  gsl_vector *ss, *x;
+  RhoModel rm;
+  size_t iter;
+  int k, status, numPara;
+  double size, n;
+
+  rm.jp = jp;
+  rm.pi = result->pi;
+  rm.b = 0.;
+  rm.h0 = (double *)emalloc(3*jp->numDist*sizeof(double));
+  rm.h2 = rm.h0 + jp->numDist;
+  rm.complementHalf = rm.h2 + jp->numDist;
+  numPara = args->Q == RHO_POWER ? 2 : 1;
+  T = gsl_multimin_fminimizer_nmsimplex;
+  ss = gsl_vector_alloc(numPara);
+  x = gsl_vector_alloc(numPara);
+  gsl_vector_set(ss, 0, RHO_STEP);
+  gsl_vector_set(x, 0, log(args->R));
+  if(numPara == 2){
+    gsl_vector_set(ss, 1, EXP_STEP);
+    gsl_vector_set(x, 1, 0.);
+  }
+  minex_func.f = &myRho;
+  minex_func.n = numPara;
+  minex_func.params = (void *)&rm;
+  s = gsl_multimin_fminimizer_alloc(T, numPara);
+  gsl_multimin_fminimizer_set(s, &minex_func, x, ss);
+  iter = 0;
+  do{
+    iter++;
+    traceBegin("rhoFitIteration", iter);
+    status = gsl_multimin_fminimizer_iterate(s);
+    traceEnd();
+    if(status)
+      break;
+    size = gsl_multimin_fminimizer_size(s);
+    status = gsl_multimin_test_size(size, args->t);
+  }while(status == GSL_CONTINUE && iter < args->i);
+  if(status != GSL_SUCCESS)
+    printf("WARNING: Joint estimation of rho failed: %d\n",status);
+  result->rh = exp(gsl_vector_get(s->x, 0));
+  if(numPara == 2)
+    rm.b = gsl_vector_get(s->x, 1);
+  result->l = rm.l = s->fval;
+  result->i = iter;
+  n = 0.;
+  for(k=0;k<jp->numDist;k++)
+    n += jp->numPos[k];
+  printf("#Joint fit of rho over distances %d to %d\n",jp->first,jp->first+(jp->numDist-1)*jp->step);
+  if(numPara == 1){
+    traceBegin("confRho", -1);
+    confRho(args, &rm, result);
+    traceEnd();
+    printf("n\t-log(L)\t\trho\n");
+    printf("%.0f\t%8.2e\t%8.2e<%8.2e<%8.2e\n",n,result->l,result->rLo,result->rh,result->rUp);
+  }else{
+    printf("n\t-log(L)\t\trho(%d)\t\tb\n",jp->first);
+    printf("%.0f\t%8.2e\t%8.2e\t%8.2e\n",n,result->l,result->rh,rm.b);
+  }
+  fflush(NULL);
+  gsl_vector_free(x);
+  gsl_vector_free(ss);
+  gsl_multimin_fminimizer_free(s);
+  free(rm.h0);
+}
+
+double myRho(const gsl_vector *v, void *params){
+  RhoModel *rm;
+  double b;
+
+  rm = (RhoModel *)params;
+  b = v->size > 1 ? gsl_vector_get(v, 1) : 0.;
+  return -rhoLik(rm, exp(gsl_vector_get(v, 0)), b);
+}
+
+/* rhoLik: composite log-likelihood of rho(d) = rho*(d/m)^b summed
+ * over the distances in a single parallel pass 
+ */
+double rhoLik(RhoModel *rm, double rho, double b){
+  JointPairs *jp;
+  double d, de, l;
+  int k;
+
+  jp = rm->jp;
+  for(k=0;k<jp->numDist;k++){
+    d = jp->first + k*jp->step;
+    de = deltaFromRho(rm->pi, rho * pow(d / jp->first, b) * d);
+    compH(rm->pi, de, &rm->h0[k], &rm->h2[k], &rm->complementHalf[k]);
+  }
+  l = 0.;
+  traceBegin("lik", -1);
+  jointLikCols(jp, rm->h0, rm->h2, rm->complementHalf, &l);
+  traceEnd();
+  return l;
+}
+
+/* rhoConfFun: log-likelihood of rho minus its maximum plus 2 */
+double rhoConfFun(double x, void *params){
+  RhoModel *rm;
+
+  rm = (RhoModel *)params;
+  return rhoLik(rm, x, rm->b) + rm->l + 2.;
+}
+
+/* confRho: likelihood interval of rho from the curvature at the 
+ * estimate with -q curvature, otherwise by root search within a 
+ * factor RHO_RANGE of the estimate 
+ */
+void confRho(Args *args, RhoModel *rm, Result *result){
+  const gsl_root_fsolver_type *solverType;
+  gsl_root_fsolver *s;
+  gsl_function fun;
+  double lo, hi;
+
+  lo = result->rh / RHO_RANGE;
+  hi = result->rh * RHO_RANGE;
+  if(args->q && curvBounds(rhoConfFun, rm, result->rh, lo, hi, &result->rLo, &result->rUp))
+    return;
+  gsl_set_error_handler_off();
+  fun.function = &rhoConfFun;
+  fun.params = rm;
+  solverType = gsl_root_fsolver_brent;
+  s = gsl_root_fsolver_alloc(solverType);
+  if(gsl_root_fsolver_set(s, &fun, lo, result->rh)){
+    printf("WARNING: Lower confidence limit of rho cannot be estimated; setting it to %8.2e.\n",lo);
+    result->rLo = lo;
+  }else
+    result->rLo = rootRho(args, s, lo, result->rh);
+  if(gsl_root_fsolver_set(s, &fun, result->rh, hi)){
+    printf("WARNING: Upper confidence limit of rho cannot be estimated; setting it to %8.2e.\n",hi);
+    result->rUp = hi;
+  }else
+    result->rUp = rootRho(args, s, result->rh, hi);
+  gsl_root_fsolver_free(s);
+}
+
+/* rootRho: iterate the root search set up in s on [xLo,xHi] */
+double rootRho(Args *args, gsl_root_fsolver *s, double xLo, double xHi){
+  int iter, status;
+  double r;
+
+  iter = 0;
+  do{
+    iter++;
+    status = gsl_root_fsolver_iterate(s);
+    r = gsl_root_fsolver_root(s);
+    xLo = gsl_root_fsolver_x_lower(s);
+    xHi = gsl_root_fsolver_x_upper(s);
+    status = gsl_root_test_interval(xLo, xHi, 0, args->t);
+  }while(status == GSL_CONTINUE && iter < args->i);
+  return r;
+}
@@ -0,0 +1,19 @@
+/***** rhoFit.h ***********************************
+ * Description: Header file for rhoFit.c.
+ * License: GNU General Public
+ **************************************************/
+#ifndef RHOFIT
+#define RHOFIT
+#include <stdio.h>
+#include "interface.h"
+#include "ld.h"
+#include "mlComp.h"
+#include "joint.h"
+
+#define RHO_STEP 0.5   /* first step of log(rho) */
+#define EXP_STEP 0.1   /* first step of the exponent b */
+#define RHO_RANGE 1e3  /* bounds of rho searched within this factor of the estimate */
+
+void runRhoFit(ContigDescr *contigDescr, FILE *fp, Args *args, Result *result);
+void fitRho(JointPairs *jp, Args *args, Result *result);
+#endif
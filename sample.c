@@ -0,0 +1,154 @@
+/***** sample.c ***********************************
+ * Description: Quick look at a database from 
+ *   subsamples of its sites. Each replicate keeps 
+ *   a fraction x of the sites, chosen by hashing
+ *   their positions with the seed z+i, so that
+ *   a replicate is reproducible. Theta, epsilon,
+ *   delta, and rho are estimated per replicate 
+ *   and reported as mean and standard deviation;
+ *   numbers of sites and pairs, and -log(L), are 
+ *   scaled up to the full database.
+ * License: GNU General Public
+ **************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <math.h>
+#include "eprintf.h"
+#include "interface.h"
+#include "profile.h"
+#include "ld.h"
+#include "mlComp.h"
+#include "profileTree.h"
+#include "reader.h"
+#include "kernel.h"
+#include "sample.h"
+
+void sampleProfiles(ContigDescr *contigDescr, FILE *fp, PackedProfiles *pp, int numProfiles);
+void meanSd(double *x, int n, double *mean, double *sd);
+
+void runSample(Args *args){
+  Result *r;
+  PackedProfiles *pp;
+  ContigDescr *contigDescr;
+  ProfilePairs *profilePairs;
+  FILE *fp;
+  char *mask;
+  double *pi, *ee, *lp, *np, *de, *rh, *ld, *nd;
+  double m[4], sd[4];
+  int i, j, k, numProfiles, numDist;
+
+  if(args->x <= 0. || args->x > 1.)
+    eprintf("the sampling fraction must lie in (0,1].");
+  printf("#Kernels: %s\n", kernelVariant());
+  readProfiles(args->n);
+  numProfiles = getNumProfiles();
+  pp = getPackedProfiles();
+  mask = NULL;
+  if(args->K > 0 || args->X < INT_MAX){
+    mask = coverageMask(pp, args->K, args->X);
+    setMask(mask);
+  }
+  fp = iniLdAna(args);
+  contigDescr = getContigDescr();
+  numDist = args->M == INT_MAX ? 0 : (args->M - args->m) / args->S + 1;
+  if(numDist < 0)
+    numDist = 0;
+  pi = (double *)emalloc(4*args->y*sizeof(double));
+  ee = pi + args->y;
+  lp = ee + args->y;
+  np = lp + args->y;
+  de = (double *)emalloc((4*(size_t)numDist*args->y+1)*sizeof(double));
+  rh = de + numDist*args->y;
+  ld = rh + numDist*args->y;
+  nd = ld + numDist*args->y;
+  r = newResult();
+  profilePairs = NULL;
+  for(i=0;i<args->y;i++){
+    setSample(args->x, args->z + i);
+    sampleProfiles(contigDescr, fp, pp, numProfiles);
+    if(i > 0){
+      freeMlComp();
+      freeSiteLik();
+    }
+    r = estimatePi(pp, numProfiles, args, r);
+    pi[i] = r->pi;
+    ee[i] = r->ee;
+    lp[i] = r->l / args->x;
+    np[i] = piComp_getNumPos(pp, numProfiles) / args->x;
+    for(j=0;j<numDist;j++){
+      k = j*args->y + i;
+      profilePairs = getProfilePairs(numProfiles, contigDescr, fp, args, args->m + j*args->S);
+      r = estimateDelta(profilePairs, numProfiles, args, r, args->m + j*args->S);
+      de[k] = r->de;
+      rh[k] = r->rh;
+      ld[k] = r->l / args->x / args->x;
+      nd[k] = getNumPos() / args->x / args->x;
+    }
+  }
+  setSample(1., 0);
+  setMask(NULL);
+  free(mask);
+  printf("#Means (standard deviations) over %d subsamples of %g of the sites\n",args->y,args->x);
+  printf("d\tn\ttheta\t\t\tepsilon\t\t\t-log(L)\n");
+  meanSd(np, args->y, &m[0], &sd[0]);
+  meanSd(pi, args->y, &m[1], &sd[1]);
+  meanSd(ee, args->y, &m[2], &sd[2]);
+  meanSd(lp, args->y, &m[3], &sd[3]);
+  printf("0\t%.0f\t%8.2e (%8.2e)\t%8.2e (%8.2e)\t%8.2e\n",m[0],m[1],sd[1],m[2],sd[2],m[3]);
+  if(numDist)
+    printf("d\tn\t-log(L)\t\tdelta\t\t\trho\n");
+  for(j=0;j<numDist;j++){
+    k = j*args->y;
+    meanSd(nd+k, args->y, &m[0], &sd[0]);
+    meanSd(ld+k, args->y, &m[1], &sd[1]);
+    meanSd(de+k, args->y, &m[2], &sd[2]);
+    meanSd(rh+k, args->y, &m[3], &sd[3]);
+    printf("%d\t%.0f\t%8.2e\t%8.2e (%8.2e)\t%8.2e (%8.2e)\n",args->m + j*args->S,m[0],m[1],m[2],sd[2],m[3],sd[3]);
+  }
+  fclose(fp);
+  free(pi);
+  free(de);
+  free(r);
+  freeMlComp();
+  freeSiteLik();
+  freeProfilePairs(profilePairs);
+  free(contigDescr->posBuf);
+  free(contigDescr->nextBuf);
+  free(contigDescr->len);
+  free(contigDescr);
+  freePackedProfiles(pp);
+}
+
+/* sampleProfiles: set the number of occurrences of each profile
+ * to its number among the sampled sites 
+ */
+void sampleProfiles(ContigDescr *contigDescr, FILE *fp, PackedProfiles *pp, int numProfiles){
+  ContigReader *cr;
+  Position *pb;
+  int i, j, len;
+
+  for(i=0;i<numProfiles;i++)
+    pp->num[i] = 0;
+  cr = openContigReader(contigDescr, fp);
+  for(i=0;i<contigDescr->n;i++){
+    pb = nextContig(cr, &len);
+    for(j=0;j<len;j++)
+      pp->num[pb[j].pro]++;
+  }
+  closeContigReader(cr);
+}
+
+void meanSd(double *x, int n, double *mean, double *sd){
+  int i;
+
+  *mean = 0.;
+  for(i=0;i<n;i++)
+    *mean += x[i];
+  *mean /= n;
+  *sd = 0.;
+  for(i=0;i<n;i++)
+    *sd += (x[i] - *mean) * (x[i] - *mean);
+  *sd = n > 1 ? sqrt(*sd / (n - 1)) : 0.;
+}
+
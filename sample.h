@@ -0,0 +1,10 @@
+/***** sample.h ***********************************
+ * Description: Header file for sample.c.
+ * License: GNU General Public
+ **************************************************/
+#ifndef SAMPLE
+#define SAMPLE
+#include "interface.h"
+
+void runSample(Args *args);
+#endif
@@ -0,0 +1,266 @@
+/***** spill.c ************************************
+ * Description: Count profile pairs out of core. 
+ *   Pair keys are buffered up to a memory limit; 
+ *   full buffers are sorted, counted, and written 
+ *   to temporary files as runs, which are merged 
+ *   into a single file of counts once all pairs 
+ *   are in. The likelihood is then computed by 
+ *   streaming this file.
+ * License: GNU General Public
+ **************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include "eprintf.h"
+#include "pairTable.h"
+#include "spill.h"
+
+#define MIN_BUF 1024  /* minimum number of records per run buffer */
+
+typedef struct runReader{ /* buffered reader of a run: */
+  FILE *fp;               /* run */
+  KeyCount *buf;          /* buffer */
+  size_t size;            /* capacity of buffer */
+  size_t n;               /* records in buffer */
+  size_t i;               /* next record */
+}RunReader;
+
+void writeRun(Spill *sp);
+void mergeRuns(Spill *sp);
+int nextRecord(RunReader *r);
+void siftDown(RunReader *r, int *heap, int n, int i);
+int cmpKey64(const void *p1, const void *p2);
+
+Spill *newSpill(size_t mem){
+  Spill *sp;
+
+  sp = (Spill *)emalloc(sizeof(Spill));
+  sp->mem = mem;
+  sp->max = mem / 2 / sizeof(uint64_t);
+  if(sp->max < MIN_BUF)
+    sp->max = MIN_BUF;
+  sp->keys = (uint64_t *)emalloc(sp->max*sizeof(uint64_t));
+  sp->n = 0;
+  sp->numRuns = 0;
+  sp->maxRuns = 16;
+  sp->runs = (FILE **)emalloc(sp->maxRuns*sizeof(FILE *));
+  sp->merged = NULL;
+  sp->pt = NULL;
+
+  return sp;
+}
+
+void spillAdd(Spill *sp, uint64_t key){
+  if(sp->n == sp->max)
+    writeRun(sp);
+  sp->keys[sp->n++] = key;
+}
+
+/* spillFinish: called after the last key; counts that fit into 
+ * memory are kept there, otherwise the runs are merged on disk 
+ */
+void spillFinish(Spill *sp){
+  size_t i, j;
+
+  if(sp->numRuns == 0){
+    sp->pt = newPairTable();
+    qsort(sp->keys,sp->n,sizeof(uint64_t),cmpKey64);
+    for(i=0;i<sp->n;i=j){
+      for(j=i+1;j<sp->n && sp->keys[j]==sp->keys[i];j++)
+	;
+      addPair(sp->pt, KEY_A(sp->keys[i]), KEY_B(sp->keys[i]), j - i);
+    }
+  }else{
+    if(sp->n)
+      writeRun(sp);
+    mergeRuns(sp);
+  }
+  sp->n = 0;
+}
+
+/* writeRun: sort and count the buffered keys and write them to
+ * a new run 
+ */
+void writeRun(Spill *sp){
+  KeyCount kc[MIN_BUF];
+  FILE *fp;
+  size_t i, j, m, n;
+
+  qsort(sp->keys,sp->n,sizeof(uint64_t),cmpKey64);
+  if((fp = tmpfile()) == NULL)
+    eprintf("tmpfile failed:");
+  m = 0;
+  for(i=0;i<sp->n;i=j){
+    for(j=i+1;j<sp->n && sp->keys[j]==sp->keys[i];j++)
+      ;
+    kc[m].key = sp->keys[i];
+    kc[m].c = j - i;
+    if(++m == MIN_BUF){
+      n = fwrite(kc,sizeof(KeyCount),m,fp);
+      assert(n == m);
+      m = 0;
+    }
+  }
+  n = fwrite(kc,sizeof(KeyCount),m,fp);
+  assert(n == m);
+  rewind(fp);
+  if(sp->numRuns == sp->maxRuns){
+    sp->maxRuns *= 2;
+    sp->runs = (FILE **)erealloc(sp->runs,sp->maxRuns*sizeof(FILE *));
+  }
+  sp->runs[sp->numRuns++] = fp;
+  sp->n = 0;
+}
+
+/* mergeRuns: merge the runs into a single file of counts using a
+ * heap of run readers; the key buffer is split among the readers 
+ */
+void mergeRuns(Spill *sp){
+  RunReader *r;
+  KeyCount out[MIN_BUF];
+  int *heap;
+  int i, h, m;
+  size_t n, bufLen;
+
+  r = (RunReader *)emalloc(sp->numRuns*sizeof(RunReader));
+  heap = (int *)emalloc(sp->numRuns*sizeof(int));
+  bufLen = sp->max * sizeof(uint64_t) / sizeof(KeyCount) / sp->numRuns;
+  if(bufLen < MIN_BUF)
+    bufLen = MIN_BUF;
+  h = 0;
+  for(i=0;i<sp->numRuns;i++){
+    r[i].fp = sp->runs[i];
+    r[i].buf = (KeyCount *)emalloc(bufLen*sizeof(KeyCount));
+    r[i].size = bufLen;
+    r[i].n = 0;
+    r[i].i = 0;
+    if(nextRecord(&r[i]))
+      heap[h++] = i;
+  }
+  for(i=h/2-1;i>=0;i--)
+    siftDown(r, heap, h, i);
+  if((sp->merged = tmpfile()) == NULL)
+    eprintf("tmpfile failed:");
+  m = 0;
+  while(h > 0){
+    i = heap[0];
+    if(m > 0 && out[m-1].key == r[i].buf[r[i].i].key)
+      out[m-1].c += r[i].buf[r[i].i].c;
+    else{
+      if(m == MIN_BUF){
+	n = fwrite(out,sizeof(KeyCount),m,sp->merged);
+	assert(n == (size_t)m);
+	m = 0;
+      }
+      out[m++] = r[i].buf[r[i].i];
+    }
+    r[i].i++;
+    if(!nextRecord(&r[i]))
+      heap[0] = heap[--h];
+    siftDown(r, heap, h, 0);
+  }
+  n = fwrite(out,sizeof(KeyCount),m,sp->merged);
+  assert(n == (size_t)m);
+  for(i=0;i<sp->numRuns;i++){
+    fclose(r[i].fp);
+    free(r[i].buf);
+  }
+  sp->numRuns = 0;
+  free(heap);
+  free(r);
+}
+
+/* nextRecord: make sure the reader has a current record; return 0 
+ * at the end of the run 
+ */
+int nextRecord(RunReader *r){
+  if(r->i < r->n)
+    return 1;
+  r->n = fread(r->buf,sizeof(KeyCount),r->size,r->fp);
+  r->i = 0;
+  return r->n > 0;
+}
+
+void siftDown(RunReader *r, int *heap, int n, int i){
+  int c, t;
+
+  while((c = 2*i+1) < n){
+    if(c+1 < n && r[heap[c+1]].buf[r[heap[c+1]].i].key < r[heap[c]].buf[r[heap[c]].i].key)
+      c++;
+    if(r[heap[i]].buf[r[heap[i]].i].key <= r[heap[c]].buf[r[heap[c]].i].key)
+      break;
+    t = heap[i];
+    heap[i] = heap[c];
+    heap[c] = t;
+    i = c;
+  }
+}
+
+/* spillLik: add the log-likelihoods of the pair counts under k
+ * sets of pair probabilities to l[0],...,l[k-1]; counts on disk 
+ * are streamed through the key buffer 
+ */
+void spillLik(Spill *sp, double *lOnes, double *lTwos, double *lScales,
+	      double *h0, double *h2, double *complementHalf, int k, double *l){
+  PairTable chunk;
+  KeyCount *kc;
+  size_t i, n, len;
+
+  if(sp->pt){
+    pairTableLikAll(sp->pt, lOnes, lTwos, lScales, h0, h2, complementHalf, k, l);
+    return;
+  }
+  /* the key buffer is idle once counting is done */
+  len = sp->max * sizeof(uint64_t) / (sizeof(KeyCount) + sizeof(CountInt) + 2*sizeof(int));
+  kc = (KeyCount *)sp->keys;
+  chunk.c = (CountInt *)(kc + len);
+  chunk.a = (int *)(chunk.c + len);
+  chunk.b = chunk.a + len;
+  chunk.max = len;
+  rewind(sp->merged);
+  while((n = fread(kc,sizeof(KeyCount),len,sp->merged)) > 0){
+    for(i=0;i<n;i++){
+      chunk.a[i] = KEY_A(kc[i].key);
+      chunk.b[i] = KEY_B(kc[i].key);
+      chunk.c[i] = kc[i].c;
+    }
+    chunk.n = n;
+    pairTableLikAll(&chunk, lOnes, lTwos, lScales, h0, h2, complementHalf, k, l);
+  }
+}
+
+/* resetSpill: drop all counts */
+void resetSpill(Spill *sp){
+  int i;
+
+  for(i=0;i<sp->numRuns;i++)
+    fclose(sp->runs[i]);
+  sp->numRuns = 0;
+  if(sp->merged)
+    fclose(sp->merged);
+  sp->merged = NULL;
+  freePairTable(sp->pt);
+  sp->pt = NULL;
+  sp->n = 0;
+}
+
+void freeSpill(Spill *sp){
+  if(sp){
+    resetSpill(sp);
+    free(sp->runs);
+    free(sp->keys);
+    free(sp);
+  }
+}
+
+int cmpKey64(const void *p1, const void *p2){
+  uint64_t k1, k2;
+
+  k1 = *(uint64_t *)p1;
+  k2 = *(uint64_t *)p2;
+  if(k1 < k2)
+    return -1;
+  else if(k1 > k2)
+    return 1;
+  return 0;
+}
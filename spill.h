@@ -0,0 +1,36 @@
+/***** spill.h ************************************
+ * Description: Header file for spill.c.
+ * License: GNU General Public
+ **************************************************/
+#ifndef SPILL
+#define SPILL
+#include <stdio.h>
+#include <stdint.h>
+#include "pairTable.h"
+
+typedef struct keyCount{ /* pair count on disk: */
+  uint64_t key;          /* packed pair */
+  int64_t c;             /* number of occurrences */
+}KeyCount;
+
+typedef struct spill{    /* pair counts under a memory limit: */
+  uint64_t *keys;        /* buffer of pair keys */
+  size_t n;              /* number of keys in buffer */
+  size_t max;            /* capacity of buffer */
+  size_t mem;            /* memory limit in bytes */
+  FILE **runs;           /* sorted runs of counts on disk */
+  int numRuns;           /* number of runs */
+  int maxRuns;           /* number of runs allocated */
+  FILE *merged;          /* merged counts on disk; or NULL */
+  PairTable *pt;         /* counts if they fit into memory; or NULL */
+}Spill;
+
+Spill *newSpill(size_t mem);
+void spillAdd(Spill *sp, uint64_t key);
+void spillFinish(Spill *sp);
+void spillLik(Spill *sp, double *lOnes, double *lTwos, double *lScales,
+	      double *h0, double *h2, double *complementHalf, int k, double *l);
+void resetSpill(Spill *sp);
+void freeSpill(Spill *sp);
+
+#endif
@@ -0,0 +1,153 @@
+/***** stream.c ***********************************
+ * Description: Estimate theta and rho from pro-
+ *   files read on stdin in the format read by 
+ *   formatPro, without writing a database: 
+ *   >contig
+ *   position<TAB>#A<TAB>#C<TAB>#G<TAB>#T
+ *   Distinct profiles are collected in a 
+ *   ProfileIndex as in append.c, and the pairs at
+ *   distances m, m+S, ..., M are counted as the 
+ *   sites arrive, from a ring of the last M+1 
+ *   positions.
+ * License: GNU General Public
+ **************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include "eprintf.h"
+#include "interface.h"
+#include "profile.h"
+#include "ld.h"
+#include "mlComp.h"
+#include "profileTree.h"
+#include "pairTable.h"
+#include "joint.h"
+#include "append.h"
+#include "bins.h"
+#include "rhoFit.h"
+#include "kernel.h"
+#include "stream.h"
+
+typedef struct window{ /* the last w positions: */
+  PosInt *pos;         /* position in slot pos % w */
+  int *pro;            /* its profile */
+  int *contig;         /* its contig */
+  int w;               /* number of slots */
+}Window;
+
+void runStream(Args *args){
+  ProfileIndex *pi;
+  Window win;
+  JointPairs *jp;
+  ProfilePairs pp;
+  Result *r;
+  char line[MAX_LINE];
+  char *outStrPi, *outStrDeltaRho;
+  int i, k, a, b, d, slot, contig, lastContig, numDist, cov, profile[4];
+  long pos;
+  PosInt p, q, last;
+
+  if(args->b || args->j || args->w || args->C || args->L || args->x > 0.)
+    eprintf("streaming cannot be combined with -b, -j, -w, -C, -L, or -x.");
+  printf("#Kernels: %s\n", kernelVariant());
+  outStrPi = "%d\t%.0f\t%8.2e<%8.2e<%8.2e\t%8.2e<%8.2e<%8.2e\t%8.2e\n";
+  outStrDeltaRho = "%d\t%.0f\t\t\t\t\t\t\t\t\t%8.2e\t%8.2e<%8.2e<%8.2e\t%8.2e<%8.2e<%8.2e\n";
+  if(args->M == INT_MAX)
+    args->M = 0;
+  numDist = args->M >= args->m ? (args->M - args->m) / args->S + 1 : 0;
+  pi = newProfileIndex((Profile *)emalloc(sizeof(Profile)), 0);
+  win.w = args->M + 1;
+  win.pos = (PosInt *)emalloc(win.w*sizeof(PosInt));
+  win.pro = (int *)emalloc(win.w*sizeof(int));
+  win.contig = (int *)emalloc(win.w*sizeof(int));
+  for(i=0;i<win.w;i++){
+    win.pos[i] = -1;
+    win.contig[i] = -1;
+  }
+  jp = numDist ? newJointPairs(args->m, args->S, numDist) : NULL;
+  /* read the profiles and count the pairs */
+  contig = lastContig = -1;
+  last = 0;
+  while(fgets(line, MAX_LINE, stdin)){
+    if(line[0] == '>'){
+      contig++;
+      continue;
+    }
+    if(sscanf(line, "%ld %d %d %d %d", &pos, &profile[0], &profile[1], &profile[2], &profile[3]) != 5)
+      continue;
+    if(contig < 0)
+      contig = 0;
+    p = (PosInt)pos;
+    if(contig == lastContig && p <= last)
+      eprintf("positions not increasing at %ld.", pos);
+    last = p;
+    lastContig = contig;
+    cov = profile[0] + profile[1] + profile[2] + profile[3];
+    if(cov < args->K || cov > args->X)
+      continue;
+    b = lookupProfile(pi, profile);
+    pi->profiles[b].n++;
+    for(k=0;k<numDist;k++){
+      q = p - (args->m + k*args->S);
+      if(q < 0)
+	break;
+      slot = q % win.w;
+      if(win.pos[slot] == q && win.contig[slot] == contig){
+	a = win.pro[slot];
+	addJointPair(jp, a < b ? PAIR_KEY(a,b) : PAIR_KEY(b,a), k);
+      }
+    }
+    slot = p % win.w;
+    win.pos[slot] = p;
+    win.pro[slot] = b;
+    win.contig[slot] = contig;
+  }
+  free(win.pos);
+  free(win.pro);
+  free(win.contig);
+  free(pi->slots);
+  if(pi->n == 0)
+    eprintf("no profiles on stdin.");
+  /* estimate theta */
+  setPackedProfiles(packProfiles(pi->profiles, pi->n));
+  setNumProfiles(pi->n);
+  free(pi->profiles);
+  r = newResult();
+  if(numDist)
+    printf("d\tn\ttheta\t\t\t\tepsilon\t\t\t\t-log(L)\t\tdelta\t\t\t\trho\n");
+  else
+    printf("d\tn\ttheta\t\t\t\tepsilon\t\t\t\t-log(L)\n");
+  r = estimatePi(getPackedProfiles(), pi->n, args, r);
+  printf(outStrPi,0,piComp_getNumPos(getPackedProfiles(),pi->n),r->pLo,r->pi,r->pUp,r->eLo,r->ee,r->eUp,r->l);
+  fflush(NULL);
+  /* estimate rho */
+  if(jp){
+    finishJointPairs(jp);
+    pp.numProfiles = pi->n;
+    pp.trees = NULL;
+    pp.dense = NULL;
+    pp.pt = NULL;
+    pp.sp = NULL;
+    pp.jp = jp;
+    pp.numCol = 1;
+    if(args->Q)
+      fitRho(jp, args, r);
+    else if(args->W)
+      fitBins(jp, pi->n, args, r);
+    else
+      for(k=0;k<numDist;k++){
+	d = args->m + k*args->S;
+	pp.col = k;
+	r = estimateDelta(&pp, pi->n, args, r, d);
+	printf(outStrDeltaRho,d,jp->numPos[k],r->l,r->dLo,r->de,r->dUp,r->rLo,r->rh,r->rUp);
+	fflush(NULL);
+      }
+    freeJointPairs(jp);
+  }
+  free(r);
+  free(pi);
+  freeMlComp();
+  freePackedProfiles(getPackedProfiles());
+  setPackedProfiles(NULL);
+}
@@ -0,0 +1,12 @@
+/***** stream.h ***********************************
+ * Description: Header file for stream.c.
+ * License: GNU General Public
+ **************************************************/
+#ifndef STREAM
+#define STREAM
+#include "interface.h"
+
+#define MAX_LINE 1024 /* maximum length of an input line */
+
+void runStream(Args *args);
+#endif
@@ -0,0 +1,165 @@
+/***** trace.c ************************************
+ * Description: Write the phases of a run as spans 
+ *   in the trace event format read by Chrome 
+ *   (chrome://tracing) and Perfetto. On Linux, the
+ *   hardware counters for cycles, cache misses and
+ *   branch misses can be attached to each span.
+ *   Spans are opened and closed in the main thread
+ *   only; without openTrace, traceBegin and 
+ *   traceEnd return at once.
+ * License: GNU General Public
+ **************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <time.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+#include "eprintf.h"
+#include "trace.h"
+
+typedef struct span{ /* open span: */
+  char *name;
+  long arg;          /* distance, contig, or iteration; -1 for none */
+  double start;      /* in microseconds */
+  uint64_t count[TRACE_COUNTERS];
+}Span;
+
+FILE *traceFp = NULL;
+Span spans[TRACE_DEPTH];
+int numSpans = 0;
+int numEvents = 0;
+double traceStart;
+int counterFd[TRACE_COUNTERS] = {-1, -1, -1};
+char *counterNames[TRACE_COUNTERS] = {"cycles", "cacheMisses", "branchMisses"};
+
+double traceTime();
+void readCounters(uint64_t *count);
+int openCounter(int config);
+
+/* openTrace: write spans to fileName; attach hardware counters if
+ * counters is set and they are available 
+ */
+void openTrace(char *fileName, int counters){
+  int i;
+
+  traceFp = efopen(fileName, "w");
+  fprintf(traceFp, "{\"traceEvents\":[\n");
+  traceStart = traceTime();
+  if(!counters)
+    return;
+#ifdef __linux__
+  counterFd[0] = openCounter(PERF_COUNT_HW_CPU_CYCLES);
+  counterFd[1] = openCounter(PERF_COUNT_HW_CACHE_MISSES);
+  counterFd[2] = openCounter(PERF_COUNT_HW_BRANCH_MISSES);
+#endif
+  for(i=0;i<TRACE_COUNTERS;i++)
+    if(counterFd[i] < 0)
+      fprintf(stderr, "WARNING: Hardware counter %s not available.\n", counterNames[i]);
+}
+
+/* traceBegin: open a span */
+void traceBegin(char *name, long arg){
+  Span *s;
+
+  if(traceFp == NULL)
+    return;
+  if(numSpans == TRACE_DEPTH)
+    eprintf("spans nested deeper than %d\n", TRACE_DEPTH);
+  s = &spans[numSpans++];
+  s->name = name;
+  s->arg = arg;
+  readCounters(s->count);
+  s->start = traceTime();
+}
+
+/* traceEnd: close the innermost span and write it as a complete
+ * event 
+ */
+void traceEnd(){
+  Span *s;
+  uint64_t count[TRACE_COUNTERS];
+  double end;
+  int i, n;
+
+  if(traceFp == NULL)
+    return;
+  end = traceTime();
+  readCounters(count);
+  s = &spans[--numSpans];
+  fprintf(traceFp, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f,\"args\":{",
+	  numEvents ? ",\n" : "", s->name, s->start - traceStart, end - s->start);
+  n = 0;
+  if(s->arg >= 0)
+    fprintf(traceFp, "\"arg\":%ld", s->arg), n++;
+  for(i=0;i<TRACE_COUNTERS;i++)
+    if(counterFd[i] >= 0)
+      fprintf(traceFp, "%s\"%s\":%" PRIu64, n++ ? "," : "", counterNames[i], 
+	      count[i] - s->count[i]);
+  fprintf(traceFp, "}}");
+  numEvents++;
+}
+
+void closeTrace(){
+  int i;
+
+  if(traceFp == NULL)
+    return;
+  while(numSpans)
+    traceEnd();
+  fprintf(traceFp, "\n],\"displayTimeUnit\":\"ms\"}\n");
+  fclose(traceFp);
+  traceFp = NULL;
+  for(i=0;i<TRACE_COUNTERS;i++)
+    if(counterFd[i] >= 0){
+      close(counterFd[i]);
+      counterFd[i] = -1;
+    }
+}
+
+/* traceTime: monotonic time in microseconds */
+double traceTime(){
+  struct timespec t;
+
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec * 1e6 + t.tv_nsec / 1e3;
+}
+
+void readCounters(uint64_t *count){
+  int i;
+
+  for(i=0;i<TRACE_COUNTERS;i++){
+    count[i] = 0;
+    if(counterFd[i] >= 0 && read(counterFd[i], &count[i], sizeof(uint64_t)) != sizeof(uint64_t))
+      count[i] = 0;
+  }
+}
+
+/* openCounter: file descriptor of a hardware counter of the calling
+ * thread and the threads it starts afterwards, counting in user 
+ * space; -1 if not available 
+ */
+int openCounter(int config){
+#ifdef __linux__
+  struct perf_event_attr attr;
+  int fd;
+
+  memset(&attr, 0, sizeof(attr));
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.size = sizeof(attr);
+  attr.config = config;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.inherit = 1;
+  fd = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+  return fd;
+#else
+  return -1;
+#endif
+}
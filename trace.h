@@ -0,0 +1,15 @@
+/***** trace.h ************************************
+ * Description: Header file for trace.c.
+ * License: GNU General Public
+ **************************************************/
+#ifndef TRACE
+#define TRACE
+
+#define TRACE_DEPTH 32    /* maximum nesting of spans */
+#define TRACE_COUNTERS 3  /* cycles, cache misses, branch misses */
+
+void openTrace(char *fileName, int counters);
+void traceBegin(char *name, long arg);
+void traceEnd();
+void closeTrace();
+#endif
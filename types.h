@@ -0,0 +1,34 @@
+/***** types.h ************************************
+ * Description: Integer types of positions and 
+ *   counts. The default 32-bit build (VER32) 
+ *   reads and writes the compact database format;
+ *   the 64-bit build (VER64) also reads and writes 
+ *   the 64-bit format, whose position and summary 
+ *   files are tagged "p64" and "s64". Contig 
+ *   lengths, that is numbers of sites per contig, 
+ *   remain int in both, so a contig holds at most 
+ *   INT_MAX sites while a database may hold more.
+ *   Distinct pairs of profiles are indexed by 
+ *   PairInt.
+ * License: GNU General Public
+ **************************************************/
+#ifndef TYPES
+#define TYPES
+#include <stdint.h>
+#include <inttypes.h>
+
+#ifdef VER64
+typedef int64_t PosInt;   /* position on a contig */
+typedef int64_t CountInt; /* number of sites or pairs */
+typedef int64_t PairInt;  /* index of a distinct pair of profiles */
+#define PAIR_MAX INT64_MAX
+#define POS_FMT "%" PRId64
+#else
+typedef int32_t PosInt;
+typedef int32_t CountInt;
+typedef int32_t PairInt;
+#define PAIR_MAX INT32_MAX
+#define POS_FMT "%" PRId32
+#endif
+
+#endif